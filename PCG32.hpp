@@ -4,6 +4,7 @@
 #include <limits>
 #include <compare>
 #include <utility>
+#include "engine_interface.hpp"
 // PCG32 - Permuted Congruential Generator
 // Based on the implementation by Melissa O'Neill (https://www.pcg-random.org)
 // C++ implementation by Ulf Benjaminsson (ulfbenjaminsson.com) 2024
@@ -11,11 +12,11 @@
 // Satisfies 'UniformRandomBitGenerator' requirements - compatible with std::shuffle, 
 // std::sample, and most std::*_distribution classes.
 
-struct PCG32{
+struct PCG32 : engine_interface<PCG32, std::uint32_t>{
     using u64 = std::uint64_t;
     using u32 = std::uint32_t;
-    using result_type = u32;
     using state_type = u64;
+    using engine_interface::next; //next(bound)
     static constexpr u64 PCG32_DEFAULT_SEED = 0x853c49e6748fea9bULL;
     static constexpr u64 PCG32_DEFAULT_STREAM = 0xda3e39cb94b95bdbULL;
     static constexpr u64 PCG32_MULT = 6364136223846793005ULL;
@@ -38,63 +39,14 @@ struct PCG32{
     constexpr result_type next() noexcept{
         const auto oldstate = state;
         state = oldstate * PCG32_MULT + (inc | 1);
-        const auto xorshifted = ((oldstate >> 18u) ^ oldstate) >> 27u;
-        const auto rot = oldstate >> 59u;
-        return static_cast<u32>((xorshifted >> rot) | (xorshifted << ((~rot + 1) & 31)));
+        return output(oldstate);
     }
 
-    constexpr result_type next(u32 bound) noexcept{
-        //highly performant Lemire's algorithm (Debiased Integer Multiplication) after research by Melissa O'Neill
-        // https://www.pcg-random.org/posts/bounded-rands.html        
-        u64 result = u64(next()) * u64(bound);
-        if(u32 lowbits = u32(result); lowbits < bound){
-            u32 threshold = u32(0) - bound;   // Calculate 2^32 - bound for rejection sampling
-            if(threshold >= bound){
-                threshold -= bound;
-                if(threshold >= bound)
-                    threshold %= bound;
-            }
-            while(lowbits < threshold){
-                result = u64(next()) * u64(bound);
-                lowbits = u32(result);
-            }
-        }
-        return result >> 32;
-    }
-
-    constexpr bool coinToss() noexcept{
-        return next() & 1; //checks the least significant bit
-    }
-
-    //generate float in [0, 1)
-    constexpr float normalized() noexcept{
-        return 0x1.0p-32f * next(); //again, courtesy of Melissa O'Neill. See: https://www.pcg-random.org/posts/bounded-rands.html
-        //0x1.0p-32 is a binary floating point constant for 2^-32 that we use to convert a random 
-        // integer value in the range [0..2^32) into a float in the unit interval 0-1        
-        //A less terrifying, but also less efficient, way to achieve the same goal  is:         
-        //    return static_cast<float>(std::ldexp(next(), -32));
-        //see https://mumble.net/~campbell/tmp/random_real.c for more info.        
-    }
-
-    //generate float in [-1, 1)    
-    constexpr float unit_range() noexcept{
-        return 2.0f * normalized() - 1.0f;
-    }
-
-    template<std::floating_point F>
-    constexpr F between(F min, F max) noexcept{
-        assert(min < max && "pcg32::between(min, max) called with inverted range.");
-        return min + (max - min) * normalized();
-    }
-
-    template<std::integral I>
-    constexpr I between(I min, I max) noexcept{
-        using UI = std::make_unsigned_t<I>;
-        static_assert(std::numeric_limits<UI>::max() <= std::numeric_limits<result_type>::max(),
-            "PCG32::between() only supports types up to PCG32::result_type in size");
-        assert(min < max && "pcg32::between(min, max) called with inverted range.");        
-        UI range = static_cast<UI>(max - min);
-        return min + static_cast<I>(next(static_cast<result_type>(range)));
+    //the XSH RR output permutation: the value next() returns when the generator is in state s
+    static constexpr result_type output(u64 s) noexcept{
+        const auto xorshifted = static_cast<u32>(((s >> 18u) ^ s) >> 27u);
+        const auto rot = static_cast<u32>(s >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((~rot + 1) & 31));
     }
 
     //Based on Brown, "Random Number Generation with Arbitrary Stride,"
@@ -133,19 +85,14 @@ struct PCG32{
         return rng;
     }
 
-    // operators and standard interface
-    constexpr result_type operator()() noexcept{
-        return next();
-    }
-    constexpr result_type operator()(u32 bound) noexcept{
-        return next(bound);
-    }
-    static result_type constexpr min() noexcept{
-        return 0;
-    }
-    static result_type constexpr max() noexcept{
-        return std::numeric_limits<result_type>::max();
+    // an independent child generator, see engine_interface::split. The child gets its own stream
+    // (increment) as well as its own position, both from splitmix64 of the parent's next output.
+    constexpr PCG32 split() noexcept{
+        const u64 bits = seed::splitmix64(portable::bits64(*this));
+        return PCG32(bits, seed::splitmix64(bits));
     }
+
+    // operators and standard interface
     constexpr void discard(u64 count) noexcept{
         advance(count);
     }
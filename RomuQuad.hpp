@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include "engine_interface.hpp"
+#include "seed.hpp"
+// RomuQuad, by Mark A. Overton: "Romu: Fast Nonlinear Pseudo-Random Number Generators Providing
+// High Quality" (2020), https://www.romu-random.org
+// Four 64-bit words for more capacity than RomuTrio, at about the same speed: every line of the
+// step is independent, so they all issue in the same cycle. Seeded with splitmix64.
+class RomuQuad : public engine_interface<RomuQuad, std::uint64_t> {
+    using u64 = std::uint64_t;
+    u64 w;
+    u64 x;
+    u64 y;
+    u64 z;
+
+    static constexpr u64 rotl(u64 v, int k) noexcept {
+        return (v << k) | (v >> (64 - k));
+    }
+
+public:
+    using engine_interface::next; //next(bound)
+
+    constexpr explicit RomuQuad(u64 seed_ = 0xBADC0FFEE0DDF00D) noexcept
+        : w(seed::splitmix64(seed_)), x(seed::splitmix64(w)), y(seed::splitmix64(x)), z(seed::splitmix64(y)) {}
+    constexpr explicit RomuQuad(std::span<const u64, 4> state) noexcept : w(state[0]), x(state[1]), y(state[2]), z(state[3]) {}
+
+    constexpr result_type next() noexcept {
+        const u64 wp = w, xp = x, yp = y, zp = z;
+        w = 15241094284759029579u * zp;
+        x = zp + rotl(wp, 52);
+        y = yp - xp;
+        z = rotl(yp + wp, 19);
+        return xp;
+    }
+
+    constexpr bool operator==(const RomuQuad&) const noexcept = default;
+
+    constexpr std::array<u64, 4> get_state() const noexcept {
+        return {w, x, y, z};
+    }
+    constexpr void set_state(std::span<const u64, 4> s) noexcept {
+        *this = RomuQuad(s);
+    }
+};
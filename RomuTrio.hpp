@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include "engine_interface.hpp"
+#include "seed.hpp"
+// RomuTrio, by Mark A. Overton: "Romu: Fast Nonlinear Pseudo-Random Number Generators Providing
+// High Quality" (2020), https://www.romu-random.org
+// Three 64-bit words, one multiply and two rotates per output. The multiply runs in parallel with
+// the rest of the step, so it is one of the fastest generators there is on superscalar CPUs.
+// Not a permutation: the period depends on the seed, but is at least 2^50 with overwhelming
+// probability (Overton's estimate for state sizes like this). Seeded with splitmix64.
+class RomuTrio : public engine_interface<RomuTrio, std::uint64_t> {
+    using u64 = std::uint64_t;
+    u64 x;
+    u64 y;
+    u64 z;
+
+    static constexpr u64 rotl(u64 v, int k) noexcept {
+        return (v << k) | (v >> (64 - k));
+    }
+
+public:
+    using engine_interface::next; //next(bound)
+
+    constexpr explicit RomuTrio(u64 seed_ = 0xBADC0FFEE0DDF00D) noexcept
+        : x(seed::splitmix64(seed_)), y(seed::splitmix64(x)), z(seed::splitmix64(y)) {}
+    constexpr explicit RomuTrio(std::span<const u64, 3> state) noexcept : x(state[0]), y(state[1]), z(state[2]) {}
+
+    constexpr result_type next() noexcept {
+        const u64 xp = x, yp = y, zp = z;
+        x = 15241094284759029579u * zp;
+        y = rotl(yp - xp, 12);
+        z = rotl(zp - yp, 44);
+        return xp;
+    }
+
+    constexpr bool operator==(const RomuTrio&) const noexcept = default;
+
+    constexpr std::array<u64, 3> get_state() const noexcept {
+        return {x, y, z};
+    }
+    constexpr void set_state(std::span<const u64, 3> s) noexcept {
+        *this = RomuTrio(s);
+    }
+};
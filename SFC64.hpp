@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include "engine_interface.hpp"
+// SFC64, Chris Doty-Humphrey's "Small Fast Chaotic" generator from PractRand (public domain).
+// The successor of Jenkins' JSF (SmallFast64): a chaotic three-word mix plus a counter, which
+// guarantees a period of at least 2^64 for every seed. Seeded like PractRand: all three words set to
+// the seed, counter at 1, then 12 rounds to mix.
+class SFC64 : public engine_interface<SFC64, std::uint64_t> {
+    using u64 = std::uint64_t;
+    u64 a;
+    u64 b;
+    u64 c;
+    u64 counter;
+
+    static constexpr u64 rotl(u64 v, int k) noexcept {
+        return (v << k) | (v >> (64 - k));
+    }
+
+public:
+    using engine_interface::next; //next(bound)
+
+    constexpr explicit SFC64(u64 seed = 0xBADC0FFEE0DDF00D) noexcept : a(seed), b(seed), c(seed), counter(1) {
+        for(auto i = 0; i < 12; ++i){
+            next();
+        }
+    }
+    constexpr explicit SFC64(std::span<const u64, 4> state) noexcept : a(state[0]), b(state[1]), c(state[2]), counter(state[3]) {}
+
+    constexpr result_type next() noexcept {
+        const u64 tmp = a + b + counter++;
+        a = b ^ (b >> 11);
+        b = c + (c << 3);
+        c = rotl(c, 24) + tmp;
+        return tmp;
+    }
+
+    constexpr bool operator==(const SFC64&) const noexcept = default;
+
+    constexpr std::array<u64, 4> get_state() const noexcept {
+        return {a, b, c, counter};
+    }
+    constexpr void set_state(std::span<const u64, 4> s) noexcept {
+        *this = SFC64(s);
+    }
+};
@@ -1,3 +1,4 @@
+#pragma once
 #include <array>
 #include <cstdint>
 #include <cassert>
@@ -5,6 +6,7 @@
 #include <span>
 #include <cmath>
 #include <utility> //for std::pair
+#include "engine_interface.hpp"
 /*
 A C++ 32-bit two-rotate implementation of the famous Jenkins Small Fast PRNG.
 Original public domain C-code and writeup by Bob Jenkins https://burtleburtle.net/bob/rand/SmallFast32.html
@@ -12,7 +14,7 @@ C++ implementation by Ulf Benjaminsson (ulfbenjaminsson.com), also placed in the
 
 Satisfies 'UniformRandomBitGenerator', meaning it works well with std::shuffle, std::sample, most of the std::*_distribution-classes, etc.
 */
-class SmallFast32
+class SmallFast32 : public engine_interface<SmallFast32, std::uint32_t>
  {
     using u32 = uint32_t;    
     u32 a;
@@ -24,142 +26,114 @@ class SmallFast32
         return (x << k) | (x >> (32 - k));
     }
 
+    static constexpr int WARMUP_ROUNDS = 20;
+    // seed_batch runs the warm-up of this many generators side by side. Only AVX-512 has vector rotates
+    // (vprol), elsewhere a rotate takes three vector instructions and the scalar rotate wins, so
+    // seed_batch then seeds one generator at a time.
+#if defined(__AVX512F__)
+    static constexpr std::size_t BATCH_LANES = 8; //256 bits per state word, stays in registers over the rounds
+#else
+    static constexpr std::size_t BATCH_LANES = 1;
+#endif
+
+    // one round of the generator, shared by next() and the batch seeding loops
+    static constexpr void step(u32& a, u32& b, u32& c, u32& d) noexcept {
+        const u32 e = a - rot(b, 27); 
+        a = b ^ rot(c, 17); 
+        b = c + d;
+        c = d + e;
+        d = e + a;
+    }
+
 public:
-    using result_type = u32;
+    using engine_interface::next; //next(bound)
+    static constexpr u32 DEFAULT_SEED = 0xBADC0FFE;
 
-    constexpr SmallFast32(u32 seed = 0xBADC0FFE) noexcept : a(0xf1ea5eed), b(seed), c(seed), d(seed) {        
+    // the state of SmallFast32(DEFAULT_SEED), computed at compile time: default constructing is a copy
+    constexpr SmallFast32() noexcept;
+
+    constexpr SmallFast32(u32 seed) noexcept : a(0xf1ea5eed), b(seed), c(seed), d(seed) {        
         // warmup: run the generator a couple of cycles to mix the state thoroughly
-        for (auto i = 0; i < 20; ++i) { 
+        for (auto i = 0; i < WARMUP_ROUNDS; ++i) { 
             next();
         }
     }
-    constexpr SmallFast32(std::span<const u32, 4> state) noexcept : a(state[0]), b(state[1]), c(state[2]), d(state[3]) {}
 
-    static constexpr result_type max() noexcept{
-        return std::numeric_limits<u32>::max();
-    }
-    
-    static constexpr result_type min() noexcept {
-        return std::numeric_limits<u32>::lowest();
-    }
+    // Seeding without the warm-up, for generators made per entity, chunk or request: the state comes
+    // from splitmix64 of the seed, see from_hash(). splitmix64 avalanches fully (each seed bit flips
+    // each state bit with probability 1/2), so the first output is as well mixed as after the 20
+    // warm-up rounds, at a fraction of the cost, and all 64 seed bits count: both pass the seed
+    // avalanche test of cycle_analysis.hpp, whose example compares the two. A different stream than
+    // SmallFast32(seed); the warm-up constructor stays as it is for existing saved seeds.
+    constexpr SmallFast32(seed::mixed_t, uint64_t seed_) noexcept : SmallFast32(from_hash(seed::splitmix64(seed_))) {}
 
-  	constexpr bool coinToss() noexcept{
-        return next() & 1; //checks the least significant bit
-    }
+    constexpr SmallFast32(std::span<const u32, 4> state) noexcept : a(state[0]), b(state[1]), c(state[2]), d(state[3]) {}
 
-    template<typename T>
-    constexpr T between(T min, T max) noexcept {
-        assert(min < max && "SmallFast32::between(min, max) called with inverted range.");
-        if constexpr (std::is_floating_point_v<T>) {
-            return min + (max - min) * normalized<T>();
-        } else if constexpr (std::is_integral_v<T>) {
-            using UT = std::make_unsigned_t<T>;
-            UT range = static_cast<UT>(max - min); 
-            assert(range != SmallFast32::max() && "SmallFast32::between() - The range is too large and may cause an overflow.");           
-            //depending on your needs, consider: if(range == max) return next();
-            return min + static_cast<T>(next(range+1));
+    // A generator straight from 64 bits that are already a hash output (coord_rng's coordinate hash):
+    // 'a' keeps Jenkins' seeding constant, b and c are the hash, d is one more splitmix64 round.
+    static constexpr SmallFast32 from_hash(uint64_t hash) noexcept {
+        return SmallFast32(0xf1ea5eed, static_cast<u32>(hash), static_cast<u32>(hash >> 32), static_cast<u32>(seed::splitmix64(hash)));
+    }
+
+    // out[i] = SmallFast32(seeds[i]), the same states as the warm-up constructor, for many generators
+    // at once: with AVX-512 the warm-up runs over BATCH_LANES generators side by side, in loops the
+    // compiler vectorizes. out can be default constructed storage, see SmallFast32().
+    static constexpr void seed_batch(std::span<const u32> seeds, std::span<SmallFast32> out) noexcept {
+        assert(seeds.size() == out.size() && "SmallFast32::seed_batch needs one seed per generator.");
+        for (std::size_t first = 0; first < seeds.size(); first += BATCH_LANES) {
+            const std::size_t n = (seeds.size() - first < BATCH_LANES) ? seeds.size() - first : BATCH_LANES;
+            std::array<u32, BATCH_LANES> sa{}, sb{}, sc{}, sd{};
+            for (std::size_t i = 0; i < n; ++i) {
+                sa[i] = 0xf1ea5eed;
+                sb[i] = sc[i] = sd[i] = seeds[first + i];
+            }
+            for (auto round = 0; round < WARMUP_ROUNDS; ++round) {
+#if defined(__GNUC__)
+#pragma GCC unroll 1 //at -O3 GCC fully unrolls the lanes into scalar rotates instead of vectorizing them
+#endif
+                for (std::size_t i = 0; i < BATCH_LANES; ++i) { //all lanes, a fixed trip count needs no scalar tail
+                    step(sa[i], sb[i], sc[i], sd[i]);
+                }
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                out[first + i] = SmallFast32(sa[i], sb[i], sc[i], sd[i]);
+            }
         }
     }
 
-    template<typename T = float>
-    constexpr T normalized() noexcept {
-        return static_cast<T>(next() * 0x1.0p-32f);
-    }
-
-    template<typename T = float>
-    constexpr T unit_range() noexcept {
-        static_assert(std::is_floating_point_v<T>, "SmallFast32::unit_range can only be used with floating point types.");
-        return static_cast<T>(2.0) * normalized<T>() - static_cast<T>(1.0);
+    // out[i] = SmallFast32(seed::mixed, seeds[i]). Scalar on purpose: splitmix64 is 64-bit multiplies, which
+    // only AVX-512DQ has as a vector instruction, and the generators are independent, so the out of
+    // order core already overlaps the seeding of consecutive ones.
+    static constexpr void seed_batch(seed::mixed_t, std::span<const uint64_t> seeds, std::span<SmallFast32> out) noexcept {
+        assert(seeds.size() == out.size() && "SmallFast32::seed_batch needs one seed per generator.");
+        for (std::size_t i = 0; i < seeds.size(); ++i) {
+            out[i] = SmallFast32(seed::mixed, seeds[i]);
+        }
     }
 
     constexpr result_type next() noexcept {
-        const u32 e = a - rot(b, 27); 
-        a = b ^ rot(c, 17); 
-        b = c + d;
-        c = d + e;
-        d = e + a;
+        step(a, b, c, d);
         return d;
     }
 
-    constexpr result_type operator()() noexcept {
-        return next();
-    }
-	
-	constexpr result_type next(u32 bound) noexcept {
-		//Lemires' algorithm. See https://www.pcg-random.org/posts/bounded-rands.html
-		// And: https://codingnest.com/random-distributions-are-not-one-size-fits-all-part-2/		
-		  uint64_t long_mult = next() * uint64_t(bound);
-		  u32 low_bits = static_cast<u32>(long_mult);		  
-		  if (low_bits < bound) {
-			u32 rejection_threshold = -bound % bound;		
-			while (low_bits < rejection_threshold) {
-			  long_mult = next() * uint64_t(bound);
-			  low_bits = u32(long_mult);
-			}
-		  }
-		  return long_mult >> 32;
-	}
-	
-	constexpr result_type operator()(u32 bound) noexcept {
-        return next(bound);
-    }
-
+    // Two bounded values from one 32-bit draw: Lemire's chained multiplies, rejected as a whole on the
+    // final low word against 2^32 mod bound^2 (see portable::bounded_batch). Use next_bounded() for
+    // other counts or mixed bounds.
     constexpr std::pair<uint16_t, uint16_t> next_2(uint16_t bound) noexcept {
         //based on https://lemire.me/blog/2024/08/17/faster-random-integer-generation-with-batching/
-        u32 random32bit = next();
-        // First multiplication: generate the first number in [0, bound)
-        u32 long_mult = (random32bit >> 16) * u32(bound);
-        uint16_t result1 = long_mult >> 16; // [0, bound)
-        uint16_t low_bits = long_mult & 0xFFFF;
-
-        // Second multiplication (reusing low_bits): generate the second number in [0, bound)
-        long_mult = low_bits * u32(bound);
-        uint16_t result2 = long_mult >> 16; // [0, bound)
-        low_bits = long_mult & 0xFFFF;
-        
-        // Check and handle bias
-        u32 product_bound = u32(bound) * u32(bound);        
-        if (low_bits < product_bound) {
-            uint16_t threshold = uint16_t(-product_bound % product_bound);
-            while (low_bits < threshold) {
-                random32bit = next(); // generate a new 32-bit random integer
-                long_mult = (random32bit >> 16) * u32(bound);
-                result1 = long_mult >> 16;
-                low_bits = long_mult & 0xFFFF;
-
-                long_mult = low_bits * u32(bound);
-                result2 = long_mult >> 16;
-                low_bits = long_mult & 0xFFFF;
+        assert(bound > 0 && "SmallFast32::next_2 called with an empty range.");
+        const u32 product = u32(bound) * u32(bound); //below 2^32
+        while (true) {
+            const uint64_t m1 = uint64_t(next()) * bound;
+            const uint64_t m2 = (m1 & 0xFFFFFFFF) * bound;
+            const auto low_bits = static_cast<u32>(m2);
+            if (low_bits >= product || low_bits >= (0u - product) % product) {
+                return std::make_pair(static_cast<uint16_t>(m1 >> 32), static_cast<uint16_t>(m2 >> 32));
             }
         }
-
-        return std::make_pair(result1, result2);
     }
 
 
-    template<typename T = float>
-    constexpr T next_gaussian(T mean, T stddev) noexcept {
-        static_assert(std::is_floating_point_v<T>, "SmallFast32::next_guassian can only be used with a floating point type");
-        static bool hasSpare = false;
-        static T spare{};
-
-        if (hasSpare) {
-            hasSpare = false;
-            return mean + stddev * spare;
-        }
-
-        hasSpare = true;
-        T u, v, s;
-        do {
-            u = unit_range<T>();
-            v = unit_range<T>();
-            s = u * u + v * v;
-        } while (s >= T(1.0) || s == T(0.0));
-        s = std::sqrt(T(-2.0) * std::log(s) / s);
-        spare = v * s;
-        return mean + stddev * (u * s);
-    }
-
     constexpr bool operator==(const SmallFast32& rhs) const noexcept {
         return (a == rhs.a) && (b == rhs.b) 
             && (c == rhs.c) && (d == rhs.d);
@@ -175,8 +149,29 @@ public:
     constexpr void set_state(std::span<const u32, 4> s) noexcept {
         *this = SmallFast32(s);
     }
+
+    // an independent child generator, see engine_interface::split. The seed constructor only takes
+    // 32 bits, so two children would share a stream after ~2^16 splits: the child gets 64 bits of
+    // splitmix64 output in b, c and d instead, then the same warmup.
+    constexpr SmallFast32 split() noexcept {
+        const auto bits = seed::splitmix64(portable::bits64(*this));
+        const auto lo = static_cast<u32>(bits);
+        const auto hi = static_cast<u32>(bits >> 32);
+        const std::array<u32, 4> s{0xf1ea5eed, lo, hi, lo ^ hi};
+        SmallFast32 child{std::span<const u32, 4>(s)};
+        child.discard(WARMUP_ROUNDS);
+        return child;
+    }
+
+private:
+    constexpr SmallFast32(u32 a_, u32 b_, u32 c_, u32 d_) noexcept : a(a_), b(b_), c(c_), d(d_) {}
 };
 
+inline constexpr std::array<std::uint32_t, 4> SMALLFAST32_DEFAULT_STATE = SmallFast32(SmallFast32::DEFAULT_SEED).get_state();
+
+constexpr SmallFast32::SmallFast32() noexcept
+    : a(SMALLFAST32_DEFAULT_STATE[0]), b(SMALLFAST32_DEFAULT_STATE[1]), c(SMALLFAST32_DEFAULT_STATE[2]), d(SMALLFAST32_DEFAULT_STATE[3]) {}
+
 /*sample usage:
 int main() {
     SmallFast32 rand(223456322);
@@ -185,7 +180,7 @@ int main() {
     [[maybe_unused]] int random_int = rand.between(-10, 10); 
     [[maybe_unused]] float random_normalized = rand.normalized(); //0.0 - 1.0
     [[maybe_unused]] float ndc = rand.unit_range();  //-1.0 - +1.0
-    //[[maybe_unused]] auto gaus = rand.next_gaussian(70.0f, 10.0f);
+    [[maybe_unused]] auto gaus = rand.next_gaussian(70.0f, 10.0f);
     [[maybe_unused]] double random_double = rand.between(1.0, 5.0); 
 
     auto state = rand.get_state();
@@ -194,8 +189,13 @@ int main() {
     //generate 2 bounded values at once:
     const auto [val1, val2] = rand.next_2(100); //two bounded 16-bit values. Max bound 65535.
 
+    SmallFast32 particle(seed::mixed, 42);      //no warm-up: two splitmix64 rounds
+    std::array<uint32_t, 1000> ids{};
+    std::array<SmallFast32, 1000> entities;     //default construction is a copy of a constant
+    SmallFast32::seed_batch(ids, entities);     //== SmallFast32(ids[i]), vectorized with AVX-512
+
    // std::array<int, 10> data = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
    // std::shuffle(data.begin(), data.end(), rand);
 
-    return val1;
+    return val1 + particle.next(10) + entities[0].next(10);
 }*/
@@ -1,3 +1,4 @@
+#pragma once
 #include <array>
 #include <cstdint>
 #include <cassert>
@@ -5,6 +6,7 @@
 #include <span>
 #include <cmath>
 #include <utility> //for std::pair
+#include "engine_interface.hpp"
 /*
 A C++ 64-bit three-rotate implementation of the famous Jenkins Small Fast PRNG. 
 Original public domain C-code and writeup by Bob Jenkins https://burtleburtle.net/bob/rand/smallprng.html
@@ -12,7 +14,7 @@ C++ implementation by Ulf Benjaminsson (ulfbenjaminsson.com), also placed in the
 
 Satisfies 'UniformRandomBitGenerator', meaning it works well with std::shuffle, std::sample, most of the std::*_distribution-classes, etc.
 */
-class SmallFast64
+class SmallFast64 : public engine_interface<SmallFast64, std::uint64_t>
  {
     using u64 = uint64_t;    
     u64 a;
@@ -24,182 +26,125 @@ class SmallFast64
         return (x << k) | (x >> (64 - k));
     }
 
+    static constexpr int WARMUP_ROUNDS = 20;
+    // seed_batch runs the warm-up of this many generators side by side. Only AVX-512 has vector rotates
+    // (vprol), elsewhere a rotate takes three vector instructions and the scalar rotate wins, so
+    // seed_batch then seeds one generator at a time.
+#if defined(__AVX512F__)
+    static constexpr std::size_t BATCH_LANES = 4; //256 bits per state word, stays in registers over the rounds
+#else
+    static constexpr std::size_t BATCH_LANES = 1;
+#endif
+
+    // one round of the generator, shared by next() and the batch seeding loops
+    static constexpr void step(u64& a, u64& b, u64& c, u64& d) noexcept {
+        // The rotate constants (7, 13, 37) are chosen specifically for 64-bit terms, to provide
+        // better avalanche characteristics, achieving 18.4 bits of avalanche after 5 rounds.
+        const u64 e = a - rot(b, 7); 
+        a = b ^ rot(c, 13); 
+        b = c + rot(d, 37);
+        c = d + e;
+        d = e + a;
+    }
+
 public:
-    using result_type = u64;
+    using engine_interface::next; //next(bound)
+    static constexpr u64 DEFAULT_SEED = 0xBADC0FFEE0DDF00D;
+
+    // the state of SmallFast64(DEFAULT_SEED), computed at compile time: default constructing is a copy
+    constexpr SmallFast64() noexcept;
 
-    constexpr SmallFast64(u64 seed = 0xBADC0FFEE0DDF00D) noexcept : a(0xf1ea5eed), b(seed), c(seed), d(seed) {        
+    constexpr SmallFast64(u64 seed) noexcept : a(0xf1ea5eed), b(seed), c(seed), d(seed) {        
         // warmup: run the generator a couple of cycles to mix the state thoroughly
-        for (auto i = 0; i < 20; ++i) { 
+        for (auto i = 0; i < WARMUP_ROUNDS; ++i) { 
             next();
         }
     }
-    constexpr SmallFast64(std::span<const u64, 4> state) noexcept : a(state[0]), b(state[1]), c(state[2]), d(state[3]) {}
 
-    static constexpr result_type max() noexcept{
-        return std::numeric_limits<u64>::max();
-    }
-    
-    static constexpr result_type min() noexcept {
-        return std::numeric_limits<u64>::lowest();
-    }
+    // Seeding without the warm-up, for generators made per entity, chunk or request: b, c and d come
+    // from a splitmix64 chain of the seed. splitmix64 avalanches fully (each seed bit flips each state
+    // bit with probability 1/2), so the first output is as well mixed as after the 20 warm-up rounds,
+    // at about a quarter of the cost: both pass the seed avalanche test of cycle_analysis.hpp, whose
+    // example compares the two. A different stream than SmallFast64(seed) for the same seed; the
+    // warm-up constructor stays as it is for existing saved seeds.
+    constexpr SmallFast64(seed::mixed_t, u64 seed_) noexcept
+        : a(0xf1ea5eed), b(seed::splitmix64(seed_)), c(seed::splitmix64(b)), d(seed::splitmix64(c)) {}
 
-  	constexpr bool coinToss() noexcept{
-        return next() & 1; //checks the least significant bit
-    }
+    constexpr SmallFast64(std::span<const u64, 4> state) noexcept : a(state[0]), b(state[1]), c(state[2]), d(state[3]) {}
 
-    template<typename T>
-    constexpr T between(T min, T max) noexcept {
-        assert(min < max && "SmallFast64::between(min, max) called with inverted range.");
-        if constexpr (std::is_floating_point_v<T>) {
-            return min + (max - min) * normalized<T>();
-        } else if constexpr (std::is_integral_v<T>) {
-            using UT = std::make_unsigned_t<T>;
-            UT range = static_cast<UT>(max - min);        
-            assert(range != SmallFast64::max() && "SmallFast64::between() - The range is too large and may cause an overflow.");           
-            //depending on your needs, consider: if(range == max) return next();    
-            return min + static_cast<T>(next(range + 1));
+    // out[i] = SmallFast64(seeds[i]), the same states as the warm-up constructor, for many generators
+    // at once: with AVX-512 the warm-up runs over BATCH_LANES generators side by side, in loops the
+    // compiler vectorizes. out can be default constructed storage, see SmallFast64().
+    static constexpr void seed_batch(std::span<const u64> seeds, std::span<SmallFast64> out) noexcept {
+        assert(seeds.size() == out.size() && "SmallFast64::seed_batch needs one seed per generator.");
+        for (std::size_t first = 0; first < seeds.size(); first += BATCH_LANES) {
+            const std::size_t n = (seeds.size() - first < BATCH_LANES) ? seeds.size() - first : BATCH_LANES;
+            std::array<u64, BATCH_LANES> sa{}, sb{}, sc{}, sd{};
+            for (std::size_t i = 0; i < n; ++i) {
+                sa[i] = 0xf1ea5eed;
+                sb[i] = sc[i] = sd[i] = seeds[first + i];
+            }
+            for (auto round = 0; round < WARMUP_ROUNDS; ++round) {
+#if defined(__GNUC__)
+#pragma GCC unroll 1 //at -O3 GCC fully unrolls the lanes into scalar rotates instead of vectorizing them
+#endif
+                for (std::size_t i = 0; i < BATCH_LANES; ++i) { //all lanes, a fixed trip count needs no scalar tail
+                    step(sa[i], sb[i], sc[i], sd[i]);
+                }
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                out[first + i] = SmallFast64(sa[i], sb[i], sc[i], sd[i]);
+            }
         }
     }
 
-    template<typename T = float>
-    constexpr T normalized() noexcept {
-        return static_cast<T>(next() * 0x1.0p-64);
-    }
-
-    template<typename T = float>
-    constexpr T unit_range() noexcept {
-        static_assert(std::is_floating_point_v<T>, "SmallFast64::unit_range can only be used with floating point types.");
-        return static_cast<T>(2.0) * normalized<T>() - static_cast<T>(1.0);
+    // out[i] = SmallFast64(seed::mixed, seeds[i]). Scalar on purpose: splitmix64 is 64-bit multiplies, which
+    // only AVX-512DQ has as a vector instruction, and the generators are independent, so the out of
+    // order core already overlaps the seeding of consecutive ones.
+    static constexpr void seed_batch(seed::mixed_t, std::span<const u64> seeds, std::span<SmallFast64> out) noexcept {
+        assert(seeds.size() == out.size() && "SmallFast64::seed_batch needs one seed per generator.");
+        for (std::size_t i = 0; i < seeds.size(); ++i) {
+            out[i] = SmallFast64(seed::mixed, seeds[i]);
+        }
     }
 
     constexpr result_type next() noexcept {
-        // The rotate constants (7, 13, 37) are chosen specifically for 64-bit terms, to provide
-        // better avalanche characteristics, achieving 18.4 bits of avalanche after 5 rounds.
-        const u64 e = a - rot(b, 7); 
-        a = b ^ rot(c, 13); 
-        b = c + rot(d, 37);
-        c = d + e;
-        d = e + a;
+        step(a, b, c, d);
         return d;
     }
 
-    constexpr result_type operator()() noexcept {
-        return next();
-    }
-
-	constexpr result_type next(u64 bound) noexcept {
-        //can't use Lemire's algorithms since uint128_t isn't portable.		
-        return static_cast<result_type>(bound * normalized());		  
-	}
-	
-	constexpr result_type operator()(u64 bound) noexcept {
-        return next(bound);
-    }
-
+    // Batched bounded draws: Lemire's chained multiplies, one 64-bit draw for several values, see
+    // portable::bounded_batch. The pair is rejected as a whole on the final low word, against
+    // 2^64 mod bound^2. Use next_bounded() for other counts or mixed bounds.
     constexpr std::pair<uint32_t, uint32_t> next_2(uint32_t bound) noexcept {
-	//batch generation of bounded integers. Based on https://lemire.me/blog/2024/08/17/faster-random-integer-generation-with-batching/
-        u64 random64bit = next();
-
-        // First multiplication: generate the first number in [0, bound)
-        u64 long_mult = (random64bit >> 32) * static_cast<u64>(bound);
-        uint32_t result1 = static_cast<uint32_t>(long_mult >> 32); // [0, bound)
-        uint32_t low_bits = static_cast<uint32_t>(long_mult & 0xFFFFFFFF);
-
-        // Second multiplication (reusing low_bits): generate the second number in [0, bound)
-        long_mult = low_bits * static_cast<u64>(bound);
-        uint32_t result2 = static_cast<uint32_t>(long_mult >> 32); // [0, bound)
-        low_bits = static_cast<uint32_t>(long_mult & 0xFFFFFFFF);
-               
-        // Check and handle bias
-        u64 product_bound = static_cast<u64>(bound) * static_cast<u64>(bound);
-        if (low_bits < product_bound) {
-            uint32_t threshold = static_cast<uint32_t>(-product_bound % product_bound);
-            while (low_bits < threshold) {
-                random64bit = next();
-                long_mult = (random64bit >> 32) * static_cast<u64>(bound);
-                result1 = static_cast<uint32_t>(long_mult >> 32);
-                low_bits = static_cast<uint32_t>(long_mult & 0xFFFFFFFF);
-
-                long_mult = low_bits * static_cast<u64>(bound);
-                result2 = static_cast<uint32_t>(long_mult >> 32);
-                low_bits = static_cast<uint32_t>(long_mult & 0xFFFFFFFF);
+        assert(bound > 0 && "SmallFast64::next_2 called with an empty range.");
+        const u64 product = static_cast<u64>(bound) * bound; //below 2^64
+        while (true) {
+            const auto m1 = portable::umul128(next(), bound);
+            const auto m2 = portable::umul128(m1.lo, bound);
+            if (m2.lo >= product || m2.lo >= (0 - product) % product) {
+                return std::make_pair(static_cast<uint32_t>(m1.hi), static_cast<uint32_t>(m2.hi));
             }
         }
-
-        return std::make_pair(result1, result2);
     }
 
+    // four values from one 64-bit draw, rejected as a whole against 2^64 mod bound^4
     constexpr std::array<uint16_t, 4> next_4(uint16_t bound) noexcept {
-        u64 random64bit = next();
-        // First multiplication: generate the first 16-bit number in [0, bound)
-        u64 long_mult = (random64bit >> 48) * static_cast<u64>(bound);
-        uint16_t result1 = static_cast<uint16_t>(long_mult >> 16); // [0, bound)
-        uint16_t low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-        // Second multiplication: generate the second 16-bit number in [0, bound)
-        long_mult = (random64bit >> 32 & 0xFFFF) * static_cast<u64>(bound);
-        uint16_t result2 = static_cast<uint16_t>(long_mult >> 16); // [0, bound)
-        low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-        // Third multiplication: generate the third 16-bit number in [0, bound)
-        long_mult = (random64bit >> 16 & 0xFFFF) * static_cast<u64>(bound);
-        uint16_t result3 = static_cast<uint16_t>(long_mult >> 16); // [0, bound)
-        low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-        // Fourth multiplication: generate the fourth 16-bit number in [0, bound)
-        long_mult = (random64bit & 0xFFFF) * static_cast<u64>(bound);
-        uint16_t result4 = static_cast<uint16_t>(long_mult >> 16); // [0, bound)
-        low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-        // Bias handling
-        u64 product_bound = static_cast<u64>(bound) * static_cast<u64>(bound);
-        if (low_bits < product_bound) {
-            uint16_t threshold = static_cast<uint16_t>(-product_bound % product_bound);
-            while (low_bits < threshold) {
-                random64bit = next();
-                // Recalculate all four results
-                long_mult = (random64bit >> 48) * static_cast<u64>(bound);
-                result1 = static_cast<uint16_t>(long_mult >> 16);
-                low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-                long_mult = (random64bit >> 32 & 0xFFFF) * static_cast<u64>(bound);
-                result2 = static_cast<uint16_t>(long_mult >> 16);
-                low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-                long_mult = (random64bit >> 16 & 0xFFFF) * static_cast<u64>(bound);
-                result3 = static_cast<uint16_t>(long_mult >> 16);
-                low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
-
-                long_mult = (random64bit & 0xFFFF) * static_cast<u64>(bound);
-                result4 = static_cast<uint16_t>(long_mult >> 16);
-                low_bits = static_cast<uint16_t>(long_mult & 0xFFFF);
+        assert(bound > 0 && "SmallFast64::next_4 called with an empty range.");
+        const u64 square = static_cast<u64>(bound) * bound;
+        const u64 product = square * square; //below 2^64
+        while (true) {
+            std::array<uint16_t, 4> result{};
+            u64 x = next();
+            for (auto& r : result) {
+                const auto m = portable::umul128(x, bound);
+                r = static_cast<uint16_t>(m.hi);
+                x = m.lo;
+            }
+            if (x >= product || x >= (0 - product) % product) {
+                return result;
             }
         }
-        return {result1, result2, result3, result4};
-    }
-
-
-    template<typename T = float>
-    constexpr T next_gaussian(T mean, T stddev) noexcept {
-        static_assert(std::is_floating_point_v<T>, "SmallFast64::next_guassian can only be used with a floating point type");
-        static bool hasSpare = false;
-        static T spare{};
-
-        if (hasSpare) {
-            hasSpare = false;
-            return mean + stddev * spare;
-        }
-
-        hasSpare = true;
-        T u, v, s;
-        do {
-            u = unit_range<T>();
-            v = unit_range<T>();
-            s = u * u + v * v;
-        } while (s >= T(1.0) || s == T(0.0));
-        s = std::sqrt(T(-2.0) * std::log(s) / s);
-        spare = v * s;
-        return mean + stddev * (u * s);
     }
 
     constexpr bool operator==(const SmallFast64& rhs) const noexcept {
@@ -217,8 +162,16 @@ public:
     constexpr void set_state(std::span<const u64, 4> s) noexcept {
         *this = SmallFast64(s);
     }
+
+private:
+    constexpr SmallFast64(u64 a_, u64 b_, u64 c_, u64 d_) noexcept : a(a_), b(b_), c(c_), d(d_) {}
 };
 
+inline constexpr std::array<std::uint64_t, 4> SMALLFAST64_DEFAULT_STATE = SmallFast64(SmallFast64::DEFAULT_SEED).get_state();
+
+constexpr SmallFast64::SmallFast64() noexcept
+    : a(SMALLFAST64_DEFAULT_STATE[0]), b(SMALLFAST64_DEFAULT_STATE[1]), c(SMALLFAST64_DEFAULT_STATE[2]), d(SMALLFAST64_DEFAULT_STATE[3]) {}
+
 //sample usage:
 /*int main() {
     SmallFast64 rand(223456321);
@@ -227,7 +180,7 @@ public:
     [[maybe_unused]] int random_int = rand.between(-10, 10); 
     [[maybe_unused]] float random_normalized = rand.normalized(); //0.0 - 1.0
     [[maybe_unused]] float ndc = rand.unit_range();  //-1.0 - +1.0
-    //[[maybe_unused]] auto gaus = rand.next_gaussian(70.0f, 10.0f);
+    [[maybe_unused]] auto gaus = rand.next_gaussian(70.0f, 10.0f);
     [[maybe_unused]] double random_double = rand.between(1.0, 5.0); 
 
     auto state = rand.get_state();
@@ -238,5 +191,14 @@ public:
 
     [[maybe_unused]] auto [val1, val2] = rand.next_2(320u); //two bounded 32-bit values. Max bound 4,294,967,295.
     [[maybe_unused]] auto [v1, v2, v3, v4] = rand.next_4(1080); //four bounded 16-bit values. Max bound 65535
-    return v4;
+
+    const std::array<uint16_t, 5> pool{6, 6, 8, 20, 20};       //a dice pool, one 64-bit draw for all five
+    std::array<uint16_t, 5> rolls{};
+    rand.next_bounded(pool, rolls);
+
+    SmallFast64 particle(seed::mixed, 42);                     //no warm-up: three splitmix64 rounds
+    std::array<uint64_t, 1000> ids{};
+    std::array<SmallFast64, 1000> entities;                     //default construction is a copy of a constant
+    SmallFast64::seed_batch(ids, entities);                     //== SmallFast64(ids[i]), vectorized with AVX-512
+    return v4 + rolls[3] + static_cast<int>(particle.next(10) + entities[0].next(10));
 } */
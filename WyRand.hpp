@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
+// wyrand, by Wang Yi (https://github.com/wangyi-fudan/wyhash), public domain.
+// A Weyl sequence (a counter with an odd increment) hashed by one 64x64 -> 128-bit multiply, the
+// high and low halves folded together. One word of state, period 2^64, every seed is good.
+// The multiply uses __int128 where available and portable::umul128 elsewhere.
+class WyRand : public engine_interface<WyRand, std::uint64_t> {
+    using u64 = std::uint64_t;
+    u64 s;
+
+public:
+    using engine_interface::next; //next(bound)
+
+    constexpr explicit WyRand(u64 seed = 0xBADC0FFEE0DDF00D) noexcept : s(seed) {}
+    constexpr explicit WyRand(std::span<const u64, 1> state) noexcept : s(state[0]) {}
+
+    constexpr result_type next() noexcept {
+        s += 0xa0761d6478bd642full;
+        const auto product = portable::umul128(s, s ^ 0xe7037ed1a0b428dbull);
+        return product.hi ^ product.lo;
+    }
+
+    constexpr bool operator==(const WyRand&) const noexcept = default;
+
+    constexpr std::array<u64, 1> get_state() const noexcept {
+        return {s};
+    }
+    constexpr void set_state(std::span<const u64, 1> state) noexcept {
+        *this = WyRand(state);
+    }
+};
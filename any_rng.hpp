@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
+// A type-erased engine for plugin boundaries and other places templates can't reach.
+//
+// std::function<uint32_t()> pays an indirect call per draw. any_rng keeps the engine in place (up to
+// 48 bytes, no heap) behind a small hand-rolled vtable whose entries are all batch operations:
+// fill(span), fill_bounded(span, bound) and fill_normalized(span). The indirect call is paid once per
+// buffer, and the loop inside runs on the concrete engine where the compiler can inline and unroll it.
+//
+// Single draws come from a local buffer of 16 values that is refilled through fill(), so next() is
+// an index bump almost every time. any_rng derives from engine_interface, so between(),
+// normalized(), next_gaussian() and friends work on it like on any other engine in this repo.
+//
+// Stream order: next() and fill() hand out the buffered values first and then continue with the
+// engine, so they see one contiguous stream. fill_bounded and fill_normalized draw straight from the
+// engine and leave the buffer for later next() calls. Either way the output is deterministic.
+//
+// Engines larger than 48 bytes (std::mt19937, Random) can be wrapped by reference: any_rng(std::ref(mt)).
+class any_rng : public engine_interface<any_rng, std::uint32_t> {
+public:
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+    using engine_interface::next; //next(bound)
+    static constexpr std::size_t STORAGE_SIZE = 48;
+    static constexpr std::size_t STORAGE_ALIGN = 16;
+    static constexpr std::size_t BUFFER_SIZE = 16;
+
+    // Copies must not throw: operator= replaces the engine in place, and the noexcept thunks work on
+    // a copy. Every engine in this repo is trivially copyable.
+    template<typename E>
+    static constexpr bool fits_in_place = sizeof(E) <= STORAGE_SIZE && alignof(E) <= STORAGE_ALIGN
+        && std::is_nothrow_move_constructible_v<E> && std::is_nothrow_copy_constructible_v<E>;
+
+    template<portable::full_range_engine E>
+        requires (!std::is_same_v<std::decay_t<E>, any_rng>)
+    any_rng(E engine) noexcept : vtable_(&vtable_for<E>) {
+        static_assert(fits_in_place<E>, "any_rng: engine is larger than 48 bytes or throws on copy, wrap it with std::ref.");
+        ::new(static_cast<void*>(storage_)) E(std::move(engine));
+    }
+
+    template<portable::full_range_engine E>
+    any_rng(std::reference_wrapper<E> engine) noexcept : any_rng(by_reference<E>{&engine.get()}) {}
+
+    any_rng(const any_rng& other) noexcept : vtable_(other.vtable_), buffer_(other.buffer_), index_(other.index_) {
+        vtable_->copy(other.storage_, storage_);
+    }
+
+    any_rng& operator=(const any_rng& other) noexcept {
+        if(this != &other){
+            vtable_->destroy(storage_);
+            vtable_ = other.vtable_;
+            vtable_->copy(other.storage_, storage_);
+            buffer_ = other.buffer_;
+            index_ = other.index_;
+        }
+        return *this;
+    }
+
+    ~any_rng() {
+        vtable_->destroy(storage_);
+    }
+
+    u32 next() noexcept {
+        if(index_ == BUFFER_SIZE){
+            vtable_->fill(storage_, buffer_);
+            index_ = 0;
+        }
+        return buffer_[index_++];
+    }
+
+    void fill(std::span<u32> out) noexcept {
+        std::size_t i = 0;
+        for(; i < out.size() && index_ < BUFFER_SIZE; ++i){
+            out[i] = buffer_[index_++];
+        }
+        if(i < out.size()){
+            vtable_->fill(storage_, out.subspan(i));
+        }
+    }
+
+    // [0, bound) for every element, bound > 0
+    void fill_bounded(std::span<u32> out, u32 bound) noexcept {
+        assert(bound > 0 && "any_rng::fill_bounded called with an empty range.");
+        vtable_->fill_bounded(storage_, out, bound);
+    }
+
+    // [0, 1) for every element
+    void fill_normalized(std::span<float> out) noexcept {
+        vtable_->fill_normalized(storage_, out);
+    }
+
+    // the wrapped engine, if it is an E (by value)
+    template<typename E>
+    E* target() noexcept {
+        return vtable_ == &vtable_for<E> ? std::launder(reinterpret_cast<E*>(storage_)) : nullptr;
+    }
+
+private:
+    struct vtable {
+        void (*fill)(void* engine, std::span<u32> out) noexcept;
+        void (*fill_bounded)(void* engine, std::span<u32> out, u32 bound) noexcept;
+        void (*fill_normalized)(void* engine, std::span<float> out) noexcept;
+        void (*copy)(const void* from, void* to) noexcept;
+        void (*destroy)(void* engine) noexcept;
+    };
+
+    template<typename E>
+    struct by_reference {
+        using result_type = typename E::result_type;
+        E* engine;
+        static constexpr result_type min() noexcept { return E::min(); }
+        static constexpr result_type max() noexcept { return E::max(); }
+        result_type operator()() noexcept(noexcept((*engine)())) { return (*engine)(); }
+    };
+
+    // The thunks work on a local copy of the engine: the stores to out could alias the engine's
+    // state in storage_, which would force a reload and store of the state on every value.
+    template<typename E>
+    static void fill_impl(void* p, std::span<u32> out) noexcept {
+        E& stored = *std::launder(static_cast<E*>(p));
+        E e = stored;
+        if constexpr(E::max() == std::numeric_limits<u64>::max()){
+            //both halves of each 64-bit draw
+            std::size_t i = 0;
+            for(; i + 1 < out.size(); i += 2){
+                const auto bits = static_cast<u64>(e());
+                out[i] = static_cast<u32>(bits >> 32);
+                out[i + 1] = static_cast<u32>(bits);
+            }
+            if(i < out.size()){
+                out[i] = portable::bits32(e);
+            }
+        } else {
+            for(auto& v : out){
+                v = static_cast<u32>(e());
+            }
+        }
+        stored = e;
+    }
+
+    template<typename E>
+    static void fill_bounded_impl(void* p, std::span<u32> out, u32 bound) noexcept {
+        E& stored = *std::launder(static_cast<E*>(p));
+        E e = stored;
+        for(auto& v : out){
+            v = static_cast<u32>(portable::bounded(e, bound));
+        }
+        stored = e;
+    }
+
+    template<typename E>
+    static void fill_normalized_impl(void* p, std::span<float> out) noexcept {
+        E& stored = *std::launder(static_cast<E*>(p));
+        E e = stored;
+        for(auto& v : out){
+            v = portable::uniform01<float>(e);
+        }
+        stored = e;
+    }
+
+    template<typename E>
+    static constexpr vtable vtable_for{
+        &fill_impl<E>,
+        &fill_bounded_impl<E>,
+        &fill_normalized_impl<E>,
+        [](const void* from, void* to) noexcept { ::new(to) E(*std::launder(static_cast<const E*>(from))); },
+        [](void* p) noexcept { std::destroy_at(std::launder(static_cast<E*>(p))); }
+    };
+
+    const vtable* vtable_;
+    alignas(STORAGE_ALIGN) std::byte storage_[STORAGE_SIZE];
+    std::array<u32, BUFFER_SIZE> buffer_{};
+    std::size_t index_ = BUFFER_SIZE;
+};
+
+/* Example usage:
+#include "any_rng.hpp"
+#include "SmallFast_64.h"
+#include "PCG32.hpp"
+
+// a plugin API without templates
+void scatter_particles(any_rng& rng, std::span<float> xs, std::span<std::uint32_t> sprites) {
+    rng.fill_normalized(xs);            //one indirect call for the whole array
+    rng.fill_bounded(sprites, 12);
+    if(rng.coinToss()){                 //single draws come from the local buffer
+        xs[0] = rng.between(-1.0f, 1.0f);
+    }
+}
+
+int main() {
+    std::array<float, 1024> xs{};
+    std::array<std::uint32_t, 1024> sprites{};
+    any_rng a = SmallFast64(42);
+    any_rng b = PCG32(7, 3);
+    std::mt19937 mt(1);
+    any_rng c = std::ref(mt);           //too big to store in place, held by reference
+    scatter_particles(a, xs, sprites);
+    scatter_particles(b, xs, sprites);
+    scatter_particles(c, xs, sprites);
+    return static_cast<int>(sprites[0]);
+}
+*/
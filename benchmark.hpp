@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <latch>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "engine_interface.hpp"
+// Speed shootout for the engines in this repo: nanoseconds per value for the raw output and the
+// common interface, so you can pick an engine per workload from numbers measured on your hardware.
+//
+// Each operation runs in a tight loop whose results are folded into a checksum (so the compiler can't
+// drop the work), several times over, and the fastest repetition is reported: the minimum is the most
+// stable estimate on a machine with other things going on.
+//
+// Build with optimizations (-O2 or better), and keep in mind that loops like these measure throughput;
+// in real code the latency of one call and the register pressure it adds matter too.
+//
+// scaling() runs an operation on 1 to 128 threads at once, for shared structures like rng_pool.
+namespace benchmark {
+    using u64 = std::uint64_t;
+
+    struct options {
+        u64 values = u64(1) << 24;   //values per repetition
+        int repetitions = 5;
+    };
+
+    struct result {
+        std::string engine;
+        std::string operation;
+        double ns_per_value;
+    };
+
+    namespace detail {
+        inline volatile u64 sink = 0;
+
+        // best ns/value over the repetitions. op(count) must produce count values and return a checksum.
+        template<typename Op>
+        double measure(Op&& op, const options& opt) {
+            double best = 1e300;
+            for(int r = 0; r < opt.repetitions; ++r){
+                const auto start = std::chrono::steady_clock::now();
+                const u64 checksum = op(opt.values);
+                const auto stop = std::chrono::steady_clock::now();
+                sink = sink + checksum;
+                best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(opt.values));
+            }
+            return best;
+        }
+    }
+
+    // ns/value for next(), next(bound), between(), normalized<float/double>(), coinToss() and fill()
+    template<random_engine Engine>
+    std::vector<result> run(std::string_view name, Engine engine, const options& opt = {}) {
+        std::vector<result> out;
+        const auto add = [&](std::string_view operation, auto&& op){
+            out.push_back({std::string(name), std::string(operation), detail::measure(op, opt)});
+        };
+        add("next()", [&](u64 n){
+            u64 sum = 0;
+            for(u64 i = 0; i < n; ++i){ sum += engine.next(); }
+            return sum;
+        });
+        add("next(1000)", [&](u64 n){
+            u64 sum = 0;
+            for(u64 i = 0; i < n; ++i){ sum += engine.next(1000); }
+            return sum;
+        });
+        add("between(1, 6)", [&](u64 n){
+            u64 sum = 0;
+            for(u64 i = 0; i < n; ++i){ sum += static_cast<u64>(engine.between(1, 6)); }
+            return sum;
+        });
+        add("normalized<float>()", [&](u64 n){
+            float sum = 0.0f;
+            for(u64 i = 0; i < n; ++i){ sum += engine.template normalized<float>(); }
+            return static_cast<u64>(sum);
+        });
+        add("normalized<double>()", [&](u64 n){
+            double sum = 0.0;
+            for(u64 i = 0; i < n; ++i){ sum += engine.template normalized<double>(); }
+            return static_cast<u64>(sum);
+        });
+        add("coinToss()", [&](u64 n){
+            u64 sum = 0;
+            for(u64 i = 0; i < n; ++i){ sum += engine.coinToss(); }
+            return sum;
+        });
+        add("fill(4096)", [&](u64 n){
+            std::array<typename Engine::result_type, 4096> block{};
+            u64 sum = 0;
+            for(u64 i = 0; i < n; i += block.size()){
+                engine.fill(block);
+                sum += block.back();
+            }
+            return sum;
+        });
+        return out;
+    }
+
+    inline constexpr std::array<int, 8> THREAD_COUNTS{1, 2, 4, 8, 16, 32, 64, 128};
+
+    // ns per operation per thread with 1 to 128 threads running op at once; flat rows mean perfect
+    // scaling. op(thread index, count) must perform count operations and return a checksum, and it is
+    // called concurrently. opt.values is per thread.
+    template<typename Op>
+    std::vector<result> scaling(std::string_view name, Op&& op, const options& opt = {}, std::span<const int> thread_counts = THREAD_COUNTS) {
+        std::vector<result> out;
+        for(const int threads : thread_counts){
+            double best = 1e300;
+            for(int r = 0; r < opt.repetitions; ++r){
+                std::latch ready(threads + 1);
+                std::latch go(1);
+                std::vector<std::jthread> workers;
+                workers.reserve(static_cast<std::size_t>(threads));
+                for(int t = 0; t < threads; ++t){
+                    workers.emplace_back([&, t]{
+                        ready.count_down();
+                        go.wait();
+                        detail::sink = detail::sink + op(t, opt.values);
+                    });
+                }
+                ready.arrive_and_wait();
+                const auto start = std::chrono::steady_clock::now();
+                go.count_down();
+                workers.clear(); //joins
+                const auto stop = std::chrono::steady_clock::now();
+                best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(opt.values));
+            }
+            out.push_back({std::string(name), std::to_string(threads) + (threads == 1 ? " thread" : " threads"), best});
+        }
+        return out;
+    }
+
+    // one row per operation, one column per engine
+    inline void write(std::ostream& os, const std::vector<result>& results) {
+        std::vector<std::string> engines, operations;
+        for(const auto& r : results){
+            if(std::find(engines.begin(), engines.end(), r.engine) == engines.end()){ engines.push_back(r.engine); }
+            if(std::find(operations.begin(), operations.end(), r.operation) == operations.end()){ operations.push_back(r.operation); }
+        }
+        os << "ns/value" << std::setw(16) << ' ';
+        for(const auto& e : engines){
+            os << std::setw(14) << e;
+        }
+        os << '\n';
+        for(const auto& op : operations){
+            os << std::left << std::setw(24) << op << std::right;
+            for(const auto& e : engines){
+                const auto it = std::find_if(results.begin(), results.end(), [&](const result& r){ return r.engine == e && r.operation == op; });
+                os << std::setw(14) << std::fixed << std::setprecision(2) << (it != results.end() ? it->ns_per_value : 0.0);
+            }
+            os << '\n';
+        }
+    }
+}
+
+/* Example usage:
+#include <iostream>
+#include "benchmark.hpp"
+#include "PCG32.hpp"
+#include "RomuQuad.hpp"
+#include "RomuTrio.hpp"
+#include "SFC64.hpp"
+#include "SmallFast_32.h"
+#include "SmallFast_64.h"
+#include "WyRand.hpp"
+#include "xoshiro256ss.h"
+
+int main() {
+    std::vector<benchmark::result> all;
+    const auto add = [&](auto name, auto engine){
+        const auto r = benchmark::run(name, engine);
+        all.insert(all.end(), r.begin(), r.end());
+    };
+    add("SmallFast32", SmallFast32(1));
+    add("SmallFast64", SmallFast64(1));
+    add("PCG32", PCG32(1));
+    add("xoshiro256**", RNG(1));
+    add("xoshiro256+", Xoshiro256p(1));
+    add("xoshiro128**", Xoshiro128ss(1));
+    add("RomuTrio", RomuTrio(1));
+    add("RomuQuad", RomuQuad(1));
+    add("WyRand", WyRand(1));
+    add("SFC64", SFC64(1));
+    benchmark::write(std::cout, all);
+}
+*/
@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
+// buffered<Engine, N>: generates N values at a time with the engine's bulk path and serves single
+// draws from the buffer.
+//
+// For engines with an expensive step (std::mt19937 regenerates 624 words at once anyway) or a bulk
+// kernel that beats a serial next() loop, single-value call sites get bulk throughput without being
+// rewritten: next() is an index bump and a load, and the refill branch is taken once every N draws.
+// The default N is four cache lines of output.
+//
+// The adapter is a full engine (engine_interface), and it is the same stream as the wrapped engine:
+// buffered<E> and E seeded alike produce identical values, and discard/advance/backstep move the
+// logical position, using the engine's own O(log n) jumps where it has them.
+//
+// The wrapped engine runs ahead of the logical position by pending() values.
+template<portable::full_range_engine Engine, std::size_t N = 256 / (Engine::max() == std::numeric_limits<std::uint32_t>::max() ? 4 : 8)>
+    requires (N > 0)
+class buffered : public engine_interface<buffered<Engine, N>,
+    std::conditional_t<Engine::max() == std::numeric_limits<std::uint32_t>::max(), std::uint32_t, std::uint64_t>> {
+public:
+    using base = engine_interface<buffered<Engine, N>,
+        std::conditional_t<Engine::max() == std::numeric_limits<std::uint32_t>::max(), std::uint32_t, std::uint64_t>>;
+    using typename base::result_type;
+    using base::next; //next(bound)
+    static constexpr std::size_t SIZE = N;
+
+    template<typename... Args>
+        requires std::is_constructible_v<Engine, Args...>
+    constexpr explicit buffered(Args&&... args) noexcept(std::is_nothrow_constructible_v<Engine, Args...>)
+        : engine_(std::forward<Args>(args)...) {}
+
+    constexpr result_type next() noexcept {
+        if(index_ == N) [[unlikely]] {
+            refill();
+        }
+        return buffer_[index_++];
+    }
+
+    // the buffered values first, then straight from the engine's bulk path
+    constexpr void fill(std::span<result_type> out) noexcept {
+        std::size_t i = 0;
+        for(; i < out.size() && index_ < N; ++i){
+            out[i] = buffer_[index_++];
+        }
+        if(i < out.size()){
+            generate(out.subspan(i));
+        }
+    }
+
+    constexpr void discard(std::uint64_t count) noexcept {
+        const std::uint64_t served = std::min<std::uint64_t>(count, pending());
+        index_ += static_cast<std::size_t>(served);
+        count -= served;
+        if(count > 0){
+            engine_.discard(count);
+        }
+    }
+
+    constexpr void advance(std::uint64_t delta) noexcept requires requires(Engine& e){ e.advance(delta); } {
+        discard(delta);
+    }
+
+    // steps back delta values. Within the buffer this is free, beyond it the engine steps back past
+    // the values it already produced.
+    constexpr void backstep(std::uint64_t delta) noexcept requires requires(Engine& e){ e.backstep(delta); } {
+        if(delta <= index_){
+            index_ -= static_cast<std::size_t>(delta);
+            return;
+        }
+        engine_.backstep(delta - index_ + N);
+        index_ = N;
+    }
+
+    // values generated but not handed out yet
+    constexpr std::size_t pending() const noexcept {
+        return N - index_;
+    }
+
+    // the wrapped engine, which is pending() values ahead of this adapter
+    constexpr const Engine& engine() const noexcept {
+        return engine_;
+    }
+
+    constexpr bool operator==(const buffered& rhs) const noexcept {
+        //equal if they will produce the same values: same engine and the same unserved values
+        if(!(engine_ == rhs.engine_) || index_ != rhs.index_){
+            return false;
+        }
+        for(std::size_t i = index_; i < N; ++i){
+            if(buffer_[i] != rhs.buffer_[i]){
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Engine engine_;
+    std::array<result_type, N> buffer_{};
+    std::size_t index_ = N;
+
+    constexpr void refill() noexcept {
+        generate(buffer_);
+        index_ = 0;
+    }
+
+    constexpr void generate(std::span<result_type> out) noexcept {
+        if constexpr(requires(Engine& e){ e.fill(out); }){
+            engine_.fill(out);
+        } else if constexpr(sizeof(Engine) <= 64){
+            Engine copy = engine_; //see engine_interface::fill
+            for(auto& v : out){
+                v = static_cast<result_type>(copy());
+            }
+            engine_ = copy;
+        } else { //too big to copy per refill (std::mt19937 is 5KB)
+            for(auto& v : out){
+                v = static_cast<result_type>(engine_());
+            }
+        }
+    }
+};
+
+/* Example usage:
+#include <random>
+#include "buffered.hpp"
+#include "PCG32.hpp"
+
+int main() {
+    // 64 values per refill, then single draws are an index bump
+    buffered<std::mt19937> mt(5489u);
+    int dice = mt.between(1, 6);
+
+    // same stream as the plain engine, rollback still works
+    buffered<PCG32> rng(42u, 7u);
+    PCG32 plain(42u, 7u);
+    rng.next();
+    rng.backstep(1);
+    bool same = rng.next() == plain.next();
+
+    std::array<std::uint32_t, 4096> noise{};
+    rng.fill(noise);                    //bulk path, no per-value branch
+    return dice + same;
+}
+*/
@@ -0,0 +1,480 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "engine_interface.hpp"
+#include "quality.hpp"
+// Seed-range analysis for engines without a proven period, like SmallFast32/64 (Jenkins' small fast
+// generator is a random invertible mapping: its cycles have random lengths, and Jenkins only showed
+// that the seeds he tried don't start on a short one). quality.hpp tests one long stream; this tests
+// the seeds you actually use:
+//
+// - Brent's cycle detection from the seeded state of every seed in [first_seed, first_seed +
+//   seed_count), with a budget of max_steps steps per seed (rounded up to a power of two). It finds
+//   every cycle with a tail below max_steps / 2 and a length of at most max_steps / 2, and reports
+//   the exact tail and length of each. A cycle that isn't found is longer, or starts further out.
+// - Adjacent seeds: streams seeded from i and i + 1 must not be correlated. For every pair:
+//   - the XOR of the two streams, output by output: its weight distribution, the agreement of each
+//     bit position, the agreement of each bit of the first outputs (where a weak warm-up shows), and
+//     the pair whose overall XOR weight is furthest from the mean, against the expected worst of
+//     that many pairs
+//   - the two streams interleaved (a, b, a, b, ...) through the full quality.hpp battery. Every
+//     stream is in two pairs, so the pairs with an even and with an odd i - first_seed go through
+//     separate batteries, where no output is counted twice.
+// - Seed avalanche: for every seed i and each of its low avalanche_bits bits, the first output of
+//   seed i against that of i with the bit flipped. Strict avalanche asks each seed bit to flip each
+//   output bit with probability 1/2; a seeding that doesn't mix enough before the first output (too
+//   few warm-up rounds) shows here first. Reports all cells together, and the one furthest from 1/2
+//   against the expected worst of that many cells.
+//
+// Seeds are handed out in blocks to all cores, with per-worker statistics merged at the end, as in
+// quality::run. Brent costs an engine step and a state comparison per step, ~1.6 ns for SmallFast32:
+// ~27 ms per seed at 2^24 steps. The adjacent seed tests at the default 2^16 outputs per stream take
+// about as long, mostly in the battery. The defaults, 4096 seeds, are a few minutes on one core.
+namespace cycle_analysis {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    struct options {
+        u64 first_seed = 0;
+        u64 seed_count = u64(1) << 12;
+        u64 max_steps = u64(1) << 24;           // per seed, 0 skips cycle detection
+        u64 words_per_pair = u64(1) << 16;      // per stream, 0 skips the adjacent seed tests. 2^11 to 2^32
+        unsigned avalanche_bits = 64;           // low seed bits that reach the engine, 0 skips the avalanche test
+        unsigned threads = 0;                   // 0 = std::thread::hardware_concurrency()
+        std::size_t complexity_block = 1000;    // see quality::options
+    };
+
+    struct short_cycle {
+        u64 seed;
+        u64 tail;   //steps from the seeded state into the cycle
+        u64 length;
+    };
+
+    struct report {
+        std::string engine;
+        options opt;
+        u64 max_steps = 0; //after rounding
+        u64 steps = 0;
+        std::vector<short_cycle> cycles{};
+        std::vector<quality::test_result> correlation{}; //the xor of adjacent streams
+        std::array<std::vector<quality::test_result>, 2> interleaved{}; //pairs with even and odd i - first_seed
+        std::vector<quality::test_result> avalanche{}; //of the first output, seed bit by output bit
+
+        bool passed() const noexcept {
+            const auto failed = [](const auto& r){ return r.failed(); };
+            return cycles.empty() && std::none_of(correlation.begin(), correlation.end(), failed)
+                && std::none_of(interleaved[0].begin(), interleaved[0].end(), failed)
+                && std::none_of(interleaved[1].begin(), interleaved[1].end(), failed)
+                && std::none_of(avalanche.begin(), avalanche.end(), failed);
+        }
+
+        void write(std::ostream& out) const {
+            out << "== " << engine << " - seeds [" << opt.first_seed << ", " << opt.first_seed + opt.seed_count << ") ==\n";
+            if(max_steps > 0){
+                out << "cycle detection, 2^" << std::countr_zero(max_steps) << " steps per seed, " << steps << " steps in total\n";
+                for(const auto& c : cycles){
+                    out << "  seed " << c.seed << ": tail " << c.tail << ", cycle length " << c.length << "  FAIL\n";
+                }
+                out << "  " << (opt.seed_count - cycles.size()) << " seeds without a cycle of tail < 2^" << std::countr_zero(max_steps) - 1
+                    << " and length <= 2^" << std::countr_zero(max_steps) - 1 << '\n';
+            }
+            if(!correlation.empty()){
+                out << "adjacent seeds (i, i + 1), " << opt.words_per_pair << " outputs per stream\n";
+                for(const auto& r : correlation){
+                    r.write(out);
+                }
+                for(int parity = 0; parity < 2; ++parity){
+                    out << "adjacent seeds interleaved, pairs with " << (parity ? "odd" : "even") << " i - first_seed\n";
+                    for(const auto& r : interleaved[parity]){
+                        r.write(out);
+                    }
+                }
+            }
+            if(!avalanche.empty()){
+                out << "seed avalanche, first output, " << opt.avalanche_bits << " seed bits\n";
+                for(const auto& r : avalanche){
+                    r.write(out);
+                }
+            }
+            out << (passed() ? "PASSED\n" : "FAILED\n");
+        }
+    };
+
+    namespace detail {
+        // Brent's cycle detection, at most max_steps (a power of two) steps from start. The tortoise
+        // waits at step 2^k - 1 while the hare runs 2^k steps past it. Returns {tail, length}.
+        template<random_engine Engine>
+        std::optional<std::pair<u64, u64>> brent(const Engine& start, u64 max_steps, u64& steps) noexcept {
+            Engine hare = start;
+            u64 length = 0;
+            for(u64 power = 1; length == 0 && 2 * power - 1 <= max_steps; power *= 2){
+                const Engine tortoise = hare;
+                u64 i = 0;
+                while(i < power){
+                    hare.next();
+                    ++i;
+                    if(hare == tortoise){
+                        length = i;
+                        break;
+                    }
+                }
+                steps += i;
+            }
+            if(length == 0){
+                return std::nullopt;
+            }
+            // the tail: a second pointer length steps ahead meets the first one at the cycle's start
+            Engine first = start;
+            Engine ahead = start;
+            for(u64 i = 0; i < length; ++i){
+                ahead.next();
+            }
+            u64 tail = 0;
+            while(!(first == ahead)){
+                first.next();
+                ahead.next();
+                ++tail;
+            }
+            steps += length + 2 * tail;
+            return std::pair{tail, length};
+        }
+
+        // Pairs of engines as one stream: a, b, a, b, ... for words_per_pair outputs of each engine,
+        // then on to the next pair. The last pair goes on for as long as it is asked.
+        template<random_engine Engine>
+        class interleaved_pairs : public engine_interface<interleaved_pairs<Engine>, typename Engine::result_type> {
+        public:
+            using result_type = typename Engine::result_type;
+            using engine_interface<interleaved_pairs, result_type>::next;
+
+            interleaved_pairs(std::vector<std::pair<Engine, Engine>> pairs, u64 words_per_pair)
+                : pairs_(std::move(pairs)), words_per_pair_(words_per_pair), left_(2 * words_per_pair) {}
+
+            result_type next() noexcept {
+                if(left_ == 0 && current_ + 1 < pairs_.size()){
+                    ++current_;
+                    left_ = 2 * words_per_pair_;
+                }
+                left_ -= (left_ > 0);
+                second_ = !second_;
+                return second_ ? pairs_[current_].first.next() : pairs_[current_].second.next();
+            }
+
+        private:
+            std::vector<std::pair<Engine, Engine>> pairs_;
+            u64 words_per_pair_;
+            u64 left_;
+            std::size_t current_ = 0;
+            bool second_ = false;
+        };
+
+        // Per-worker statistics of the adjacent seed tests, merged after all seeds are done.
+        template<random_engine Engine>
+        class pair_tests {
+            using result_type = typename Engine::result_type;
+            static constexpr int BITS = std::numeric_limits<result_type>::digits;
+            static constexpr int WEIGHT_SPREAD = BITS / 4;  //weights outside BITS/2 +- this are pooled
+            static constexpr std::size_t FIRST_OUTPUTS = 8;
+
+            std::array<quality::battery<interleaved_pairs<Engine>>, 2> batteries_; //by parity of i - first_seed
+            std::vector<u64> weights_ = std::vector<u64>(2 * WEIGHT_SPREAD + 1);
+            std::vector<u64> agree_ = std::vector<u64>(BITS);
+            std::vector<u64> agree_first_ = std::vector<u64>(FIRST_OUTPUTS * BITS);
+            u64 pairs_ = 0;
+            u64 outputs_ = 0;
+            double worst_z_ = 0.0;
+            u64 worst_seed_ = 0;
+
+            static std::vector<double> weight_probabilities() {
+                std::vector<double> p(2 * WEIGHT_SPREAD + 1, 0.0);
+                for(int w = 0; w <= BITS; ++w){
+                    const double binomial = std::exp(std::lgamma(BITS + 1.0) - std::lgamma(w + 1.0) - std::lgamma(BITS - w + 1.0) - BITS * std::log(2.0));
+                    p[static_cast<std::size_t>(std::clamp(w - (BITS / 2 - WEIGHT_SPREAD), 0, 2 * WEIGHT_SPREAD))] += binomial;
+                }
+                return p;
+            }
+
+            // sum of z^2 of bit agreement counts, n pairs of outputs each, against 1/2
+            static quality::test_result agreement_test(std::string name, const std::vector<u64>& agree, u64 n) {
+                double chi2 = 0.0;
+                for(const u64 a : agree){
+                    const double z = (static_cast<double>(a) - 0.5 * static_cast<double>(n)) / std::sqrt(0.25 * static_cast<double>(n));
+                    chi2 += z * z;
+                }
+                return {std::move(name), chi2, quality::stats::chi_square_p(chi2, static_cast<double>(agree.size()))};
+            }
+
+        public:
+            // the xor tests of the pair (seed, seed + 1)
+            void compare(Engine a, Engine b, u64 seed, const options& opt) {
+                const auto weight = [&](result_type differ){
+                    const int w = std::popcount(differ);
+                    ++weights_[static_cast<std::size_t>(std::clamp(w - (BITS / 2 - WEIGHT_SPREAD), 0, 2 * WEIGHT_SPREAD))];
+                    return static_cast<u64>(w);
+                };
+                u64 total_weight = 0;
+                u64 i = 0;
+                for(; i < FIRST_OUTPUTS && i < opt.words_per_pair; ++i){
+                    const result_type differ = a.next() ^ b.next();
+                    total_weight += weight(differ);
+                    for(int bit = 0; bit < BITS; ++bit){
+                        agree_first_[i * BITS + bit] += ((differ >> bit) & 1) ^ 1;
+                    }
+                }
+                // 32-bit counters and masks instead of shifts (SSE2 has no per-lane shift): the bit loop vectorizes
+                constexpr auto MASKS = []{
+                    std::array<u32, 32> m{};
+                    for(int bit = 0; bit < 32; ++bit){ m[bit] = u32(1) << bit; }
+                    return m;
+                }();
+                std::array<u32, BITS> agree{};
+                for(; i < opt.words_per_pair; ++i){
+                    const result_type differ = a.next() ^ b.next();
+                    total_weight += weight(differ);
+                    for(int half = 0; half < BITS / 32; ++half){
+                        const auto word = static_cast<u32>(static_cast<u64>(differ) >> (32 * half));
+                        for(int bit = 0; bit < 32; ++bit){
+                            agree[32 * half + bit] += static_cast<u32>((word & MASKS[bit]) == 0);
+                        }
+                    }
+                }
+                for(int bit = 0; bit < BITS; ++bit){
+                    agree_[bit] += agree[bit];
+                }
+                const double n = static_cast<double>(opt.words_per_pair);
+                const double z = (static_cast<double>(total_weight) - n * BITS / 2.0) / std::sqrt(n * BITS / 4.0);
+                if(std::fabs(z) > std::fabs(worst_z_) || pairs_ == 0){
+                    worst_z_ = z;
+                    worst_seed_ = seed;
+                }
+                ++pairs_;
+                outputs_ += opt.words_per_pair;
+            }
+
+            // pairs that share no seed, interleaved as one stream through the battery of their parity.
+            // One battery pass per block of pairs, not per pair: its linear complexity test has a fixed
+            // cost per pass.
+            void interleave(std::vector<std::pair<Engine, Engine>> pairs, int parity, const options& opt) {
+                const auto words = static_cast<std::size_t>(2 * opt.words_per_pair * pairs.size());
+                interleaved_pairs<Engine> stream(std::move(pairs), opt.words_per_pair);
+                batteries_[parity].consume(stream, words, opt.complexity_block);
+            }
+
+            void merge(const pair_tests& other) {
+                batteries_[0].merge(other.batteries_[0]);
+                batteries_[1].merge(other.batteries_[1]);
+                const auto add = [](auto& into, const auto& from){
+                    for(std::size_t i = 0; i < into.size(); ++i){ into[i] += from[i]; }
+                };
+                add(weights_, other.weights_);
+                add(agree_, other.agree_);
+                add(agree_first_, other.agree_first_);
+                if(other.pairs_ > 0 && (pairs_ == 0 || std::fabs(other.worst_z_) > std::fabs(worst_z_))){
+                    worst_z_ = other.worst_z_;
+                    worst_seed_ = other.worst_seed_;
+                }
+                pairs_ += other.pairs_;
+                outputs_ += other.outputs_;
+            }
+
+            std::vector<quality::test_result> xor_results() const {
+                std::vector<quality::test_result> out;
+                out.push_back(quality::stats::chi_square_test("xor weight", weights_, weight_probabilities()));
+                out.push_back(agreement_test("xor bit agreement", agree_, outputs_ - FIRST_OUTPUTS * pairs_));
+                out.push_back(agreement_test("xor bits, first " + std::to_string(FIRST_OUTPUTS) + " outputs", agree_first_, pairs_));
+                // P(the largest |z| of pairs_ normal variables >= |worst_z_|)
+                const double one = std::erfc(std::fabs(worst_z_) / std::sqrt(2.0));
+                const double p = (one >= 1.0) ? 1.0 : -std::expm1(static_cast<double>(pairs_) * std::log1p(-one));
+                out.push_back({"worst pair xor weight, z", worst_z_, p, "seeds " + std::to_string(worst_seed_) + ", " + std::to_string(worst_seed_ + 1)});
+                return out;
+            }
+
+            std::vector<quality::test_result> interleaved_results(int parity, std::size_t complexity_block) const {
+                return batteries_[parity].results(complexity_block);
+            }
+        };
+
+        // Per-worker flip counts of the seed avalanche test: flips_[k * BITS + j] counts the seeds
+        // where setting seed bit k flipped bit j of the first output, out of pairs_[k] seeds. Only
+        // seeds with bit k clear count, or a pair of seeds in the range would be counted twice.
+        template<random_engine Engine>
+        class avalanche_test {
+            using result_type = typename Engine::result_type;
+            static constexpr int BITS = std::numeric_limits<result_type>::digits;
+
+            std::vector<u64> flips_ = std::vector<u64>(64 * BITS);
+            std::array<u64, 64> pairs_{};
+
+        public:
+            template<typename MakeEngine>
+            void add(MakeEngine& make_engine, u64 seed, const options& opt) {
+                const result_type first = make_engine(seed).next();
+                for(unsigned k = 0; k < opt.avalanche_bits; ++k){
+                    if((seed >> k) & 1){
+                        continue;
+                    }
+                    const result_type differ = first ^ make_engine(seed | (u64(1) << k)).next();
+                    for(int bit = 0; bit < BITS; ++bit){
+                        flips_[k * BITS + bit] += (differ >> bit) & 1;
+                    }
+                    ++pairs_[k];
+                }
+            }
+
+            void merge(const avalanche_test& other) {
+                for(std::size_t i = 0; i < flips_.size(); ++i){
+                    flips_[i] += other.flips_[i];
+                }
+                for(std::size_t k = 0; k < pairs_.size(); ++k){
+                    pairs_[k] += other.pairs_[k];
+                }
+            }
+
+            std::vector<quality::test_result> results(const options& opt) const {
+                const std::size_t cells = opt.avalanche_bits * BITS;
+                const auto z = [&](std::size_t i){
+                    const double n = static_cast<double>(pairs_[i / BITS]);
+                    return (n == 0.0) ? 0.0 : (static_cast<double>(flips_[i]) - 0.5 * n) / std::sqrt(0.25 * n);
+                };
+                double chi2 = 0.0;
+                std::size_t worst = 0;
+                for(std::size_t i = 0; i < cells; ++i){
+                    chi2 += z(i) * z(i);
+                    if(std::fabs(z(i)) > std::fabs(z(worst))){
+                        worst = i;
+                    }
+                }
+                std::vector<quality::test_result> out;
+                out.push_back({"seed bit -> output bit flips", chi2, quality::stats::chi_square_p(chi2, static_cast<double>(cells))});
+                // P(the largest |z| of that many cells >= the worst one's), as for the worst xor pair
+                const double one = std::erfc(std::fabs(z(worst)) / std::sqrt(2.0));
+                const double p = (one >= 1.0) ? 1.0 : -std::expm1(static_cast<double>(cells) * std::log1p(-one));
+                const double n = static_cast<double>(pairs_[worst / BITS]);
+                out.push_back({"worst seed bit -> output bit, z", z(worst), p, "seed bit " + std::to_string(worst / BITS) + " -> bit "
+                    + std::to_string(worst % BITS) + ", flips " + std::to_string(static_cast<double>(flips_[worst]) / n)
+                    + " of " + std::to_string(pairs_[worst / BITS])});
+                return out;
+            }
+        };
+    }
+
+    // Runs the analyses over the seed range. MakeEngine is any callable u64 seed -> Engine, as for
+    // quality::run, so the seeding under test is yours (eg: [](auto s){ return SmallFast32(seed::to_32(s)); }).
+    template<typename MakeEngine>
+    report run(std::string name, MakeEngine make_engine, const options& opt = {}) {
+        using Engine = std::invoke_result_t<MakeEngine&, u64>;
+        static_assert(random_engine<Engine> && std::equality_comparable<Engine>, "cycle_analysis::run needs an engine with next() and operator==.");
+        assert(opt.avalanche_bits <= 64 && "cycle_analysis::run: a seed has 64 bits.");
+        constexpr u64 BLOCK_SEEDS = 32; //even, so i - first_seed has the same parity in every block
+        const unsigned thread_count = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+        const u64 max_steps = opt.max_steps ? std::bit_ceil(opt.max_steps) : 0;
+        const u64 block_count = (opt.seed_count + BLOCK_SEEDS - 1) / BLOCK_SEEDS;
+
+        struct partial_result {
+            u64 steps = 0;
+            std::vector<short_cycle> cycles{};
+            detail::pair_tests<Engine> pairs;
+            detail::avalanche_test<Engine> avalanche;
+        };
+        std::vector<partial_result> partial(thread_count);
+        std::atomic<u64> next_block{0};
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < thread_count; ++t){
+            workers.emplace_back([&, t]{
+                auto& mine = partial[t];
+                for(u64 b; (b = next_block.fetch_add(1, std::memory_order_relaxed)) < block_count;){
+                    const u64 end = std::min(opt.seed_count, (b + 1) * BLOCK_SEEDS);
+                    std::array<std::vector<std::pair<Engine, Engine>>, 2> chains;
+                    for(u64 i = b * BLOCK_SEEDS; i < end; ++i){
+                        const u64 s = opt.first_seed + i;
+                        if(max_steps > 0){
+                            if(const auto c = detail::brent(make_engine(s), max_steps, mine.steps)){
+                                mine.cycles.push_back({s, c->first, c->second});
+                            }
+                        }
+                        if(opt.words_per_pair > 0){
+                            const Engine a = make_engine(s);
+                            const Engine next = make_engine(s + 1);
+                            mine.pairs.compare(a, next, s, opt);
+                            chains[i & 1].emplace_back(a, next);
+                        }
+                        if(opt.avalanche_bits > 0){
+                            mine.avalanche.add(make_engine, s, opt);
+                        }
+                    }
+                    for(int parity = 0; parity < 2; ++parity){
+                        if(!chains[parity].empty()){
+                            mine.pairs.interleave(std::move(chains[parity]), parity, opt);
+                        }
+                    }
+                }
+            });
+        }
+        for(auto& w : workers){
+            w.join();
+        }
+
+        report r{std::move(name), opt, max_steps};
+        for(unsigned t = 0; t < thread_count; ++t){
+            r.steps += partial[t].steps;
+            r.cycles.insert(r.cycles.end(), partial[t].cycles.begin(), partial[t].cycles.end());
+            if(t > 0){
+                partial[0].pairs.merge(partial[t].pairs);
+                partial[0].avalanche.merge(partial[t].avalanche);
+            }
+        }
+        std::sort(r.cycles.begin(), r.cycles.end(), [](const auto& x, const auto& y){ return x.seed < y.seed; });
+        if(opt.words_per_pair > 0){
+            r.correlation = partial[0].pairs.xor_results();
+            r.interleaved = {partial[0].pairs.interleaved_results(0, opt.complexity_block), partial[0].pairs.interleaved_results(1, opt.complexity_block)};
+        }
+        if(opt.avalanche_bits > 0){
+            r.avalanche = partial[0].avalanche.results(opt);
+        }
+        return r;
+    }
+}
+
+/* Example usage:
+#include <fstream>
+#include <iostream>
+#include "SmallFast_32.h"
+#include "SmallFast_64.h"
+#include "cycle_analysis.hpp"
+
+int main() {
+    cycle_analysis::options opt;
+    opt.first_seed = 0;
+    opt.seed_count = 1 << 16;   //the entity ids we seed with
+    opt.max_steps = 1 << 20;
+
+    auto opt32 = opt;
+    opt32.avalanche_bits = 32; //the warm-up constructor takes a 32-bit seed
+
+    // the 20 round warm-up against seed::mixed (splitmix64, no warm-up)
+    std::ofstream file("cycle_report.txt");
+    bool all_passed = true;
+    for(const auto& r : {
+        cycle_analysis::run("SmallFast32", [](auto s){ return SmallFast32(static_cast<std::uint32_t>(s)); }, opt32),
+        cycle_analysis::run("SmallFast32, seed::mixed", [](auto s){ return SmallFast32(seed::mixed, s); }, opt),
+        cycle_analysis::run("SmallFast64", [](auto s){ return SmallFast64(s); }, opt),
+        cycle_analysis::run("SmallFast64, seed::mixed", [](auto s){ return SmallFast64(seed::mixed, s); }, opt)}){
+        r.write(std::cout);
+        r.write(file);
+        all_passed &= r.passed();
+    }
+    return all_passed ? 0 : 1;
+}
+*/
@@ -0,0 +1,1088 @@
+#pragma once
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "portable_math.hpp"
+#include "ziggurat.hpp"
+// Portable, deterministic replacements for the std::*_distribution classes.
+//
+// The std:: distributions are specified by their output distribution, not their algorithm, so
+// libstdc++, libc++ and MSVC all produce different sequences from the same engine and seed. The
+// distributions here use one fixed algorithm each (documented on the class), draw a fixed number of
+// bits per attempt and only use the deterministic math in portable_math.hpp. Seed any engine in
+// this repo the same way on any platform and you get the same numbers out.
+//
+// Available: uniform_int, uniform_real, bernoulli, normal, exponential, gamma, beta, dirichlet,
+// poisson, binomial and discrete. Uniform draws use Lemire's multiply-and-reject bounded integers
+// and multiply-based float conversion, which is both portable and faster than the libstdc++
+// implementations.
+//
+// They follow the std:: distribution interface (result_type, param_type, reset(), min(), max(),
+// operator()(g) and operator()(g, param)) so they drop in where you use the std:: ones today, and
+// add a bulk fill(span, g). Everything is constexpr.
+//
+// Works with any engine producing full-range 32- or 64-bit output (SmallFast32, SmallFast64, PCG32,
+// std::mt19937, std::mt19937_64, ...).
+PORTABLE_FP_BEGIN
+namespace portable {
+
+    // Uniform integers in [a, b], inclusive. Lemire's bounded draw on (b - a + 1), see bounded() in portable_math.hpp.
+    // The full 64-bit range returns raw bits64.
+    template<std::integral IntType = int>
+    class uniform_int_distribution {
+    public:
+        using result_type = IntType;
+
+        class param_type {
+        public:
+            using distribution_type = uniform_int_distribution;
+            constexpr explicit param_type(IntType a = 0, IntType b = std::numeric_limits<IntType>::max()) noexcept : a_(a), b_(b) {
+                assert(a <= b && "uniform_int_distribution: requires a <= b.");
+            }
+            constexpr IntType a() const noexcept { return a_; }
+            constexpr IntType b() const noexcept { return b_; }
+            constexpr bool operator==(const param_type&) const noexcept = default;
+        private:
+            IntType a_;
+            IntType b_;
+        };
+
+        constexpr uniform_int_distribution() noexcept : uniform_int_distribution(0) {}
+        constexpr explicit uniform_int_distribution(IntType a, IntType b = std::numeric_limits<IntType>::max()) noexcept : p_(a, b) {}
+        constexpr explicit uniform_int_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            using UT = std::make_unsigned_t<IntType>;
+            const auto range = static_cast<u64>(static_cast<UT>(static_cast<UT>(p.b()) - static_cast<UT>(p.a())));
+            const u64 offset = (range == std::numeric_limits<u64>::max()) ? bits64(g) : bounded(g, range + 1);
+            return static_cast<IntType>(static_cast<UT>(static_cast<UT>(p.a()) + static_cast<UT>(offset)));
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr IntType a() const noexcept { return p_.a(); }
+        constexpr IntType b() const noexcept { return p_.b(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        constexpr result_type min() const noexcept { return p_.a(); }
+        constexpr result_type max() const noexcept { return p_.b(); }
+        constexpr bool operator==(const uniform_int_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Uniform reals in [a, b): a + (b - a) * u, where u = uniform01<RealType>() (24 random bits for
+    // float, 53 for double, by multiplication). Draws again in the rare case rounding lands on b.
+    template<std::floating_point RealType = double>
+    class uniform_real_distribution {
+    public:
+        using result_type = RealType;
+
+        class param_type {
+        public:
+            using distribution_type = uniform_real_distribution;
+            constexpr explicit param_type(RealType a = RealType(0), RealType b = RealType(1)) noexcept : a_(a), b_(b) {
+                assert(a < b && "uniform_real_distribution: requires a < b.");
+            }
+            constexpr RealType a() const noexcept { return a_; }
+            constexpr RealType b() const noexcept { return b_; }
+            constexpr bool operator==(const param_type&) const noexcept = default;
+        private:
+            RealType a_;
+            RealType b_;
+        };
+
+        constexpr uniform_real_distribution() noexcept : uniform_real_distribution(RealType(0)) {}
+        constexpr explicit uniform_real_distribution(RealType a, RealType b = RealType(1)) noexcept : p_(a, b) {}
+        constexpr explicit uniform_real_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            const RealType scale = p.b() - p.a();
+            RealType x;
+            do{
+                x = p.a() + scale * uniform01<RealType>(g);
+            } while(x >= p.b());
+            return x;
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr RealType a() const noexcept { return p_.a(); }
+        constexpr RealType b() const noexcept { return p_.b(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        constexpr result_type min() const noexcept { return p_.a(); }
+        constexpr result_type max() const noexcept { return p_.b(); }
+        constexpr bool operator==(const uniform_real_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // true with probability p. Always exactly one engine draw, compared against p scaled to the
+    // engine's width (p * 2^32 for 32-bit engines, p * 2^64 for 64-bit engines).
+    class bernoulli_distribution {
+    public:
+        using result_type = bool;
+
+        class param_type {
+        public:
+            using distribution_type = bernoulli_distribution;
+            constexpr explicit param_type(double p = 0.5) noexcept : p_(p) {
+                assert(p >= 0.0 && p <= 1.0 && "bernoulli_distribution: requires 0 <= p <= 1.");
+                always = (p >= 1.0);
+                threshold32 = always ? 0 : static_cast<u32>(p * 0x1.0p32);
+                threshold64 = always ? 0 : static_cast<u64>(p * 0x1.0p64);
+            }
+            constexpr double p() const noexcept { return p_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return p_ == rhs.p_; }
+        private:
+            friend class bernoulli_distribution;
+            double p_;
+            bool always = false;
+            u32 threshold32 = 0;
+            u64 threshold64 = 0;
+        };
+
+        constexpr bernoulli_distribution() noexcept : bernoulli_distribution(0.5) {}
+        constexpr explicit bernoulli_distribution(double p) noexcept : p_(p) {}
+        constexpr explicit bernoulli_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            if constexpr(G::max() == std::numeric_limits<u64>::max()){
+                return (static_cast<u64>(g()) < p.threshold64) || p.always;
+            } else {
+                return (static_cast<u32>(g()) < p.threshold32) || p.always;
+            }
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr double p() const noexcept { return p_.p(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return false; }
+        static constexpr result_type max() noexcept { return true; }
+        constexpr bool operator==(const bernoulli_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Normal distribution: Marsaglia & Tsang's 256-layer ziggurat (see ziggurat.hpp), mean + stddev * z.
+    // One 64-bit draw per sample ~99% of the time. Stateless: no cached spare value, so copies and
+    // threads never share hidden state.
+    template<std::floating_point RealType = double>
+    class normal_distribution {
+    public:
+        using result_type = RealType;
+
+        class param_type {
+        public:
+            using distribution_type = normal_distribution;
+            constexpr explicit param_type(RealType mean = RealType(0), RealType stddev = RealType(1)) noexcept : mean_(mean), stddev_(stddev) {
+                assert(stddev > RealType(0) && "normal_distribution: stddev must be positive.");
+            }
+            constexpr RealType mean() const noexcept { return mean_; }
+            constexpr RealType stddev() const noexcept { return stddev_; }
+            constexpr bool operator==(const param_type&) const noexcept = default;
+        private:
+            RealType mean_;
+            RealType stddev_;
+        };
+
+        constexpr normal_distribution() noexcept : normal_distribution(RealType(0)) {}
+        constexpr explicit normal_distribution(RealType mean, RealType stddev = RealType(1)) noexcept : p_(mean, stddev) {}
+        constexpr explicit normal_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            return static_cast<RealType>(static_cast<double>(p.mean()) + static_cast<double>(p.stddev()) * ziggurat::normal(g));
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr RealType mean() const noexcept { return p_.mean(); }
+        constexpr RealType stddev() const noexcept { return p_.stddev(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return std::numeric_limits<RealType>::lowest(); }
+        static constexpr result_type max() noexcept { return std::numeric_limits<RealType>::max(); }
+        constexpr bool operator==(const normal_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Exponential distribution: Marsaglia & Tsang's 256-layer ziggurat (see ziggurat.hpp), scaled by
+    // 1/lambda. One 64-bit draw per sample ~99% of the time.
+    template<std::floating_point RealType = double>
+    class exponential_distribution {
+    public:
+        using result_type = RealType;
+
+        class param_type {
+        public:
+            using distribution_type = exponential_distribution;
+            constexpr explicit param_type(RealType lambda = RealType(1)) noexcept : lambda_(lambda) {
+                assert(lambda > RealType(0) && "exponential_distribution: lambda must be positive.");
+            }
+            constexpr RealType lambda() const noexcept { return lambda_; }
+            constexpr bool operator==(const param_type&) const noexcept = default;
+        private:
+            RealType lambda_;
+        };
+
+        constexpr exponential_distribution() noexcept : exponential_distribution(RealType(1)) {}
+        constexpr explicit exponential_distribution(RealType lambda) noexcept : p_(lambda) {}
+        constexpr explicit exponential_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            return static_cast<RealType>(ziggurat::exponential(g) / static_cast<double>(p.lambda()));
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            const double inv_lambda = 1.0 / static_cast<double>(p_.lambda());
+            for(auto& x : out){
+                x = static_cast<RealType>(ziggurat::exponential(g) * inv_lambda);
+            }
+        }
+
+        constexpr RealType lambda() const noexcept { return p_.lambda(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return RealType(0); }
+        static constexpr result_type max() noexcept { return std::numeric_limits<RealType>::infinity(); }
+        constexpr bool operator==(const exponential_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Marsaglia & Tsang's gamma sampler, "A simple method for generating gamma variables" (2000), shared by
+    // gamma, beta and dirichlet. For shape >= 1: d = shape - 1/3, c = 1/sqrt(9d), and d(1 + cx)^3 for
+    // a normal x is accepted with a squeeze that skips the log ~98% of the time. One ziggurat normal
+    // and one 53-bit uniform per attempt, ~1.02-1.05 attempts. Shapes below 1 sample shape + 1 and
+    // boost the result by u^(1/shape), as e^(-E/shape) with E from the exponential ziggurat.
+    namespace marsaglia_tsang {
+        struct shape_params {
+            double d;
+            double c;
+            double inv_shape; //1/shape when boosting shapes below 1, otherwise 0
+        };
+
+        constexpr shape_params prepare(double shape) noexcept {
+            const double boosted = (shape < 1.0) ? shape + 1.0 : shape;
+            const double d = boosted - 1.0 / 3.0;
+            return {d, 1.0 / portable::sqrt(9.0 * d), (shape < 1.0) ? 1.0 / shape : 0.0};
+        }
+
+        // Gamma(shape + 1 if boosted, 1)
+        template<full_range_engine G>
+        constexpr double unboosted(G& g, const shape_params& p) noexcept {
+            while(true){
+                const double x = ziggurat::normal(g);
+                double v = 1.0 + p.c * x;
+                if(v <= 0.0){
+                    continue;
+                }
+                v = v * v * v;
+                const double u = uniform01_open(g);
+                const double x2 = x * x;
+                if(u < 1.0 - 0.0331 * x2 * x2){
+                    return p.d * v;
+                }
+                if(portable::log(u) < 0.5 * x2 + p.d * (1.0 - v + portable::log(v))){
+                    return p.d * v;
+                }
+            }
+        }
+
+        // Gamma(shape, 1)
+        template<full_range_engine G>
+        constexpr double sample(G& g, const shape_params& p) noexcept {
+            const double x = unboosted(g, p);
+            if(p.inv_shape == 0.0){
+                return x;
+            }
+            return x * portable::exp(-ziggurat::exponential(g) * p.inv_shape); //u^(1/shape) = e^(-E/shape), E ~ Exp(1)
+        }
+
+        // log(Gamma(shape, 1)), which doesn't underflow for small shapes where the variate itself does
+        template<full_range_engine G>
+        constexpr double log_sample(G& g, const shape_params& p) noexcept {
+            const double log_x = portable::log(unboosted(g, p));
+            if(p.inv_shape == 0.0){
+                return log_x;
+            }
+            return log_x - ziggurat::exponential(g) * p.inv_shape;
+        }
+    }
+
+    // Gamma distribution with shape alpha and scale beta (mean alpha * beta), as std::gamma_distribution.
+    // Marsaglia & Tsang (see above), with the constants precomputed in param_type.
+    template<std::floating_point RealType = double>
+    class gamma_distribution {
+    public:
+        using result_type = RealType;
+
+        class param_type {
+        public:
+            using distribution_type = gamma_distribution;
+            constexpr explicit param_type(RealType alpha = RealType(1), RealType beta = RealType(1)) noexcept
+                : alpha_(alpha), beta_(beta), shape_(marsaglia_tsang::prepare(static_cast<double>(alpha))) {
+                assert(alpha > RealType(0) && "gamma_distribution: alpha must be positive.");
+                assert(beta > RealType(0) && "gamma_distribution: beta must be positive.");
+            }
+            constexpr RealType alpha() const noexcept { return alpha_; }
+            constexpr RealType beta() const noexcept { return beta_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return alpha_ == rhs.alpha_ && beta_ == rhs.beta_; }
+        private:
+            friend class gamma_distribution;
+            RealType alpha_;
+            RealType beta_;
+            marsaglia_tsang::shape_params shape_;
+        };
+
+        constexpr gamma_distribution() noexcept : gamma_distribution(RealType(1)) {}
+        constexpr explicit gamma_distribution(RealType alpha, RealType beta = RealType(1)) noexcept : p_(alpha, beta) {}
+        constexpr explicit gamma_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            return static_cast<RealType>(marsaglia_tsang::sample(g, p.shape_) * static_cast<double>(p.beta_));
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            const marsaglia_tsang::shape_params shape = p_.shape_;
+            const auto scale = static_cast<double>(p_.beta_);
+            for(auto& x : out){
+                x = static_cast<RealType>(marsaglia_tsang::sample(g, shape) * scale);
+            }
+        }
+
+        constexpr RealType alpha() const noexcept { return p_.alpha(); }
+        constexpr RealType beta() const noexcept { return p_.beta(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return RealType(0); }
+        static constexpr result_type max() noexcept { return std::numeric_limits<RealType>::infinity(); }
+        constexpr bool operator==(const gamma_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Beta distribution on [0, 1] with shapes a and b (mean a / (a + b)): X / (X + Y) for X ~ Gamma(a)
+    // and Y ~ Gamma(b). When a shape is below 1 the ratio is taken in log space, 1 / (1 + e^(log Y - log X)),
+    // because both gammas can underflow to 0.
+    template<std::floating_point RealType = double>
+    class beta_distribution {
+    public:
+        using result_type = RealType;
+
+        class param_type {
+        public:
+            using distribution_type = beta_distribution;
+            constexpr explicit param_type(RealType a = RealType(1), RealType b = RealType(1)) noexcept
+                : a_(a), b_(b), shape_a_(marsaglia_tsang::prepare(static_cast<double>(a))), shape_b_(marsaglia_tsang::prepare(static_cast<double>(b))) {
+                assert(a > RealType(0) && "beta_distribution: a must be positive.");
+                assert(b > RealType(0) && "beta_distribution: b must be positive.");
+            }
+            constexpr RealType a() const noexcept { return a_; }
+            constexpr RealType b() const noexcept { return b_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return a_ == rhs.a_ && b_ == rhs.b_; }
+        private:
+            friend class beta_distribution;
+            RealType a_;
+            RealType b_;
+            marsaglia_tsang::shape_params shape_a_;
+            marsaglia_tsang::shape_params shape_b_;
+        };
+
+        constexpr beta_distribution() noexcept : beta_distribution(RealType(1)) {}
+        constexpr explicit beta_distribution(RealType a, RealType b = RealType(1)) noexcept : p_(a, b) {}
+        constexpr explicit beta_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            if(p.shape_a_.inv_shape == 0.0 && p.shape_b_.inv_shape == 0.0){
+                const double x = marsaglia_tsang::sample(g, p.shape_a_);
+                const double y = marsaglia_tsang::sample(g, p.shape_b_);
+                return static_cast<RealType>(x / (x + y));
+            }
+            const double log_x = marsaglia_tsang::log_sample(g, p.shape_a_);
+            const double log_y = marsaglia_tsang::log_sample(g, p.shape_b_);
+            return static_cast<RealType>(1.0 / (1.0 + portable::exp(log_y - log_x)));
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr RealType a() const noexcept { return p_.a(); }
+        constexpr RealType b() const noexcept { return p_.b(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return RealType(0); }
+        static constexpr result_type max() noexcept { return RealType(1); }
+        constexpr bool operator==(const beta_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+
+    // Dirichlet distribution over k weights that sum to 1, with concentrations alpha: k gammas
+    // Gamma(alpha_i), normalized by their sum (in log space when some alpha is below 1, see beta).
+    // Not in std::, and vector valued: operator()(g, out) writes one sample of k weights, fill(out, g)
+    // writes out.size() / k samples back to back.
+    template<std::floating_point RealType = double>
+    class dirichlet_distribution {
+    public:
+        using result_type = std::vector<RealType>;
+
+        class param_type {
+        public:
+            using distribution_type = dirichlet_distribution;
+            constexpr param_type() : param_type({1.0, 1.0}) {}
+            template<std::input_iterator It>
+            constexpr param_type(It first, It last) : alpha_(first, last) {
+                build();
+            }
+            constexpr param_type(std::initializer_list<double> alpha) : param_type(alpha.begin(), alpha.end()) {}
+            constexpr std::vector<double> alpha() const { return alpha_; }
+            constexpr std::size_t size() const noexcept { return alpha_.size(); }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return alpha_ == rhs.alpha_; }
+        private:
+            friend class dirichlet_distribution;
+            std::vector<double> alpha_;
+            std::vector<marsaglia_tsang::shape_params> shapes_;
+            bool log_space_ = false;
+
+            constexpr void build() {
+                assert(!alpha_.empty() && "dirichlet_distribution: needs at least one concentration.");
+                shapes_.reserve(alpha_.size());
+                for(double a : alpha_){
+                    assert(a > 0.0 && "dirichlet_distribution: concentrations must be positive.");
+                    shapes_.push_back(marsaglia_tsang::prepare(a));
+                    log_space_ = log_space_ || a < 1.0;
+                }
+            }
+        };
+
+        constexpr dirichlet_distribution() : p_() {}
+        template<std::input_iterator It>
+        constexpr dirichlet_distribution(It first, It last) : p_(first, last) {}
+        constexpr dirichlet_distribution(std::initializer_list<double> alpha) : p_(alpha) {}
+        constexpr explicit dirichlet_distribution(const param_type& p) : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) {
+            result_type out(p_.size());
+            (*this)(g, out);
+            return out;
+        }
+
+        // one sample into out, out.size() == size(). No allocation.
+        template<full_range_engine G>
+        constexpr void operator()(G& g, std::span<RealType> out) noexcept {
+            sample(g, p_, out);
+        }
+
+        template<full_range_engine G>
+        constexpr void operator()(G& g, std::span<RealType> out, const param_type& p) noexcept {
+            sample(g, p, out);
+        }
+
+        // out.size() / size() samples, each size() weights
+        template<full_range_engine G>
+        constexpr void fill(std::span<RealType> out, G& g) noexcept {
+            const std::size_t k = p_.size();
+            assert(out.size() % k == 0 && "dirichlet_distribution::fill: output is not a whole number of samples.");
+            for(std::size_t i = 0; i + k <= out.size(); i += k){
+                sample(g, p_, out.subspan(i, k));
+            }
+        }
+
+        constexpr std::vector<double> alpha() const { return p_.alpha(); }
+        constexpr std::size_t size() const noexcept { return p_.size(); }
+        constexpr param_type param() const { return p_; }
+        constexpr void param(const param_type& p) { p_ = p; }
+        constexpr bool operator==(const dirichlet_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+
+        template<full_range_engine G>
+        static constexpr void sample(G& g, const param_type& p, std::span<RealType> out) noexcept {
+            assert(out.size() == p.size() && "dirichlet_distribution: output size differs from the number of concentrations.");
+            const std::size_t k = p.size();
+            if(!p.log_space_){
+                double sum = 0.0;
+                for(std::size_t i = 0; i < k; ++i){
+                    const double x = marsaglia_tsang::sample(g, p.shapes_[i]);
+                    out[i] = static_cast<RealType>(x);
+                    sum += x;
+                }
+                const double inv_sum = 1.0 / sum;
+                for(auto& x : out){
+                    x = static_cast<RealType>(static_cast<double>(x) * inv_sum);
+                }
+                return;
+            }
+            //log space: logs kept in out, then exp(log - max) normalized, so the largest weight is never 0
+            double max_log = -std::numeric_limits<double>::infinity();
+            for(std::size_t i = 0; i < k; ++i){
+                const double log_x = marsaglia_tsang::log_sample(g, p.shapes_[i]);
+                out[i] = static_cast<RealType>(log_x);
+                max_log = (log_x > max_log) ? log_x : max_log;
+            }
+            double sum = 0.0;
+            for(auto& x : out){
+                const double w = portable::exp(static_cast<double>(x) - max_log);
+                x = static_cast<RealType>(w);
+                sum += w;
+            }
+            const double inv_sum = 1.0 / sum;
+            for(auto& x : out){
+                x = static_cast<RealType>(static_cast<double>(x) * inv_sum);
+            }
+        }
+    };
+
+    // Poisson distribution.
+    // - mean < 10: inversion by sequential search from 0. One 53-bit uniform per sample.
+    // - mean >= 10: Hormann's PTRS, "The transformed rejection method for generating Poisson random
+    //   variables" (1993). Two 53-bit uniforms per attempt, constant expected time (~1.15 attempts)
+    //   no matter how large the mean.
+    template<std::integral IntType = int>
+    class poisson_distribution {
+    public:
+        using result_type = IntType;
+        static constexpr double PTRS_THRESHOLD = 10.0;
+
+        class param_type {
+        public:
+            using distribution_type = poisson_distribution;
+            constexpr explicit param_type(double mean = 1.0) noexcept : mean_(mean) {
+                assert(mean > 0.0 && "poisson_distribution: mean must be positive.");
+                if(mean < PTRS_THRESHOLD){
+                    exp_neg_mean = portable::exp(-mean);
+                    return;
+                }
+                log_mean = portable::log(mean);
+                b = 0.931 + 2.53 * portable::sqrt(mean);
+                a = -0.059 + 0.02483 * b;
+                log_inv_alpha = portable::log(1.1239 + 1.1328 / (b - 3.4));
+                v_r = 0.9277 - 3.6224 / (b - 2.0);
+            }
+            constexpr double mean() const noexcept { return mean_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return mean_ == rhs.mean_; }
+        private:
+            friend class poisson_distribution;
+            double mean_;
+            double exp_neg_mean = 0.0; //inversion
+            double log_mean = 0.0;     //PTRS
+            double a = 0.0;
+            double b = 0.0;
+            double log_inv_alpha = 0.0;
+            double v_r = 0.0;
+        };
+
+        constexpr poisson_distribution() noexcept : poisson_distribution(1.0) {}
+        constexpr explicit poisson_distribution(double mean) noexcept : p_(mean) {}
+        constexpr explicit poisson_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            return (p.mean_ < PTRS_THRESHOLD) ? inversion(g, p) : ptrs(g, p);
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            if(p_.mean_ < PTRS_THRESHOLD){
+                for(auto& x : out){ x = inversion(g, p_); }
+            } else {
+                for(auto& x : out){ x = ptrs(g, p_); }
+            }
+        }
+
+        constexpr double mean() const noexcept { return p_.mean(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+        constexpr bool operator==(const poisson_distribution&) const noexcept = default;
+
+    private:
+        param_type p_;
+
+        template<full_range_engine G>
+        static constexpr result_type inversion(G& g, const param_type& p) noexcept {
+            while(true){
+                double u = uniform01(g);
+                double prob = p.exp_neg_mean;
+                for(result_type k = 0; k < 256; ++k){ //mean < 10, the tail beyond 256 is below rounding noise
+                    if(u < prob){
+                        return k;
+                    }
+                    u -= prob;
+                    prob *= p.mean_ / static_cast<double>(k + 1);
+                }
+            }
+        }
+
+        template<full_range_engine G>
+        static constexpr result_type ptrs(G& g, const param_type& p) noexcept {
+            constexpr auto MAX = static_cast<double>(std::numeric_limits<result_type>::max());
+            while(true){
+                const double u = uniform01_open(g) - 0.5;
+                const double v = uniform01_open(g);
+                const double us = 0.5 - portable::abs(u);
+                const double k = portable::floor((2.0 * p.a / us + p.b) * u + p.mean_ + 0.43);
+                if(us >= 0.07 && v <= p.v_r){
+                    if(k > MAX){ continue; }
+                    return static_cast<result_type>(k);
+                }
+                if(k < 0.0 || k > MAX || (us < 0.013 && v > us)){
+                    continue;
+                }
+                const double lhs = portable::log(v) + p.log_inv_alpha - portable::log(p.a / (us * us) + p.b);
+                const double rhs = -p.mean_ + k * p.log_mean - portable::log_factorial(static_cast<std::int64_t>(k));
+                if(lhs <= rhs){
+                    return static_cast<result_type>(k);
+                }
+            }
+        }
+    };
+
+    // Binomial distribution. Works on p' = min(p, 1-p) and mirrors the result when p > 0.5.
+    // - n*p' < ~10: inversion by sequential search from 0 (Kachitvichyanukul & Schmeiser's BINV).
+    // - otherwise: Hormann's BTRD, "The generation of binomial random variates" (1993). Constant
+    //   expected time, ~1.15 53-bit uniforms per sample on average.
+    template<std::integral IntType = int>
+    class binomial_distribution {
+    public:
+        using result_type = IntType;
+
+        class param_type {
+        public:
+            using distribution_type = binomial_distribution;
+            constexpr explicit param_type(IntType t = 1, double p = 0.5) noexcept : t_(t), p_(p) {
+                assert(t >= 0 && p >= 0.0 && p <= 1.0 && "binomial_distribution: requires t >= 0 and 0 <= p <= 1.");
+                flip = p > 0.5;
+                q = flip ? 1.0 - p : p;
+                const auto n = static_cast<double>(t);
+                m = static_cast<IntType>(portable::floor((n + 1.0) * q));
+                if(q == 0.0 || t == 0){
+                    return;
+                }
+                use_btrd = m >= 11;
+                if(!use_btrd){
+                    q_n = portable::exp(n * portable::log1p(-q));
+                    return;
+                }
+                r = q / (1.0 - q);
+                nr = (n + 1.0) * r;
+                npq = n * q * (1.0 - q);
+                const double sqrt_npq = portable::sqrt(npq);
+                b = 1.15 + 2.53 * sqrt_npq;
+                a = -0.0873 + 0.0248 * b + 0.01 * q;
+                c = n * q + 0.5;
+                alpha = (2.83 + 5.1 / b) * sqrt_npq;
+                v_r = 0.92 - 4.2 / b;
+                u_rv_r = 0.86 * v_r;
+            }
+            constexpr IntType t() const noexcept { return t_; }
+            constexpr double p() const noexcept { return p_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return t_ == rhs.t_ && p_ == rhs.p_; }
+        private:
+            friend class binomial_distribution;
+            IntType t_;
+            double p_;
+            bool flip = false;
+            bool use_btrd = false;
+            double q = 0.0;        //min(p, 1-p)
+            IntType m = 0;         //mode
+            double q_n = 0.0;      //inversion: (1-q)^t
+            double r = 0.0;        //BTRD setup
+            double nr = 0.0;
+            double npq = 0.0;
+            double a = 0.0;
+            double b = 0.0;
+            double c = 0.0;
+            double alpha = 0.0;
+            double v_r = 0.0;
+            double u_rv_r = 0.0;
+        };
+
+        constexpr binomial_distribution() noexcept : binomial_distribution(1, 0.5) {}
+        constexpr explicit binomial_distribution(IntType t, double p = 0.5) noexcept : p_(t, p) {}
+        constexpr explicit binomial_distribution(const param_type& p) noexcept : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            if(p.q == 0.0 || p.t_ == 0){
+                return p.flip ? p.t_ : 0;
+            }
+            const result_type k = p.use_btrd ? btrd(g, p) : inversion(g, p);
+            return p.flip ? p.t_ - k : k;
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr IntType t() const noexcept { return p_.t(); }
+        constexpr double p() const noexcept { return p_.p(); }
+        constexpr param_type param() const noexcept { return p_; }
+        constexpr void param(const param_type& p) noexcept { p_ = p; }
+        static constexpr result_type min() noexcept { return 0; }
+        constexpr result_type max() const noexcept { return p_.t(); }
+        constexpr bool operator==(const binomial_distribution&) const noexcept = default;
+
+    private:
+        param_type p_;
+
+        template<full_range_engine G>
+        static constexpr result_type inversion(G& g, const param_type& p) noexcept {
+            const double s = p.q / (1.0 - p.q);
+            const double a = (static_cast<double>(p.t_) + 1.0) * s;
+            double prob = p.q_n;
+            double u = uniform01(g);
+            result_type x = 0;
+            while(u > prob && x < p.t_){
+                u -= prob;
+                ++x;
+                const double next = (a / static_cast<double>(x) - s) * prob;
+                if(next < std::numeric_limits<double>::epsilon() && next < prob){
+                    break; //deep in the tail, the remaining mass is rounding noise
+                }
+                prob = next;
+            }
+            return x;
+        }
+
+        template<full_range_engine G>
+        static constexpr result_type btrd(G& g, const param_type& p) noexcept {
+            const IntType n = p.t_;
+            const IntType m = p.m;
+            while(true){
+                double v = uniform01(g);
+                double u;
+                if(v <= p.u_rv_r){ //the triangle in the center, ~86% of all samples
+                    u = v / p.v_r - 0.43;
+                    return static_cast<result_type>(portable::floor((2.0 * p.a / (0.5 - portable::abs(u)) + p.b) * u + p.c));
+                }
+                if(v >= p.v_r){
+                    u = uniform01(g) - 0.5;
+                } else {
+                    u = v / p.v_r - 0.93;
+                    u = ((u < 0.0) ? -0.5 : 0.5) - u;
+                    v = uniform01(g) * p.v_r;
+                }
+                const double us = 0.5 - portable::abs(u);
+                const double kd = portable::floor((2.0 * p.a / us + p.b) * u + p.c);
+                if(kd < 0.0 || kd > static_cast<double>(n)){
+                    continue;
+                }
+                const auto k = static_cast<IntType>(kd);
+                v = v * p.alpha / (p.a / (us * us) + p.b);
+                const auto km = static_cast<double>(k > m ? k - m : m - k);
+                if(km <= 15.0){ //recursive evaluation of f(k)
+                    double f = 1.0;
+                    if(m < k){
+                        for(IntType i = m + 1; i <= k; ++i){
+                            f *= p.nr / static_cast<double>(i) - p.r;
+                        }
+                    } else if(m > k){
+                        for(IntType i = k + 1; i <= m; ++i){
+                            v *= p.nr / static_cast<double>(i) - p.r;
+                        }
+                    }
+                    if(v <= f){
+                        return k;
+                    }
+                    continue;
+                }
+                //squeeze acceptance / rejection, then the final test with Stirling's approximation
+                v = portable::log(v);
+                const double rho = (km / p.npq) * (((km / 3.0 + 0.625) * km + 1.0 / 6.0) / p.npq + 0.5);
+                const double t = -km * km / (2.0 * p.npq);
+                if(v < t - rho){
+                    return k;
+                }
+                if(v > t + rho){
+                    continue;
+                }
+                const auto nd = static_cast<double>(n);
+                const auto md = static_cast<double>(m);
+                const auto kd1 = static_cast<double>(k);
+                const double nm = nd - md + 1.0;
+                const double h = (md + 0.5) * portable::log((md + 1.0) / (p.r * nm)) + stirling_correction(m) + stirling_correction(n - m);
+                const double nk = nd - kd1 + 1.0;
+                if(v <= h + (nd + 1.0) * portable::log(nm / nk) + (kd1 + 0.5) * portable::log(nk * p.r / (kd1 + 1.0))
+                    - stirling_correction(k) - stirling_correction(n - k)){
+                    return k;
+                }
+            }
+        }
+    };
+
+    // Discrete distribution over {0, ..., n-1} with the given weights. Walker's alias method, with
+    // the table built by Vose's algorithm ("A linear algorithm for generating random numbers with a
+    // given distribution", 1991). O(n) setup, O(1) per sample: one 64-bit draw, the high 32 bits
+    // pick a column (Lemire, unbiased) and the low 32 bits choose between the column and its alias.
+    template<std::integral IntType = int>
+    class discrete_distribution {
+    public:
+        using result_type = IntType;
+
+        class param_type {
+        public:
+            using distribution_type = discrete_distribution;
+            constexpr param_type() : param_type(std::initializer_list<double>{}) {}
+            template<std::input_iterator It>
+            constexpr param_type(It first, It last) : probabilities_(first, last) {
+                build();
+            }
+            constexpr param_type(std::initializer_list<double> weights) : param_type(weights.begin(), weights.end()) {}
+            template<typename UnaryOperation>
+            constexpr param_type(std::size_t count, double xmin, double xmax, UnaryOperation fw) {
+                const std::size_t n = (count == 0) ? 1 : count;
+                const double delta = (xmax - xmin) / static_cast<double>(n);
+                probabilities_.reserve(n);
+                for(std::size_t i = 0; i < n; ++i){
+                    probabilities_.push_back(fw(xmin + static_cast<double>(i) * delta + delta / 2.0));
+                }
+                build();
+            }
+            constexpr std::vector<double> probabilities() const { return probabilities_; }
+            constexpr bool operator==(const param_type& rhs) const noexcept { return probabilities_ == rhs.probabilities_; }
+        private:
+            friend class discrete_distribution;
+            std::vector<double> probabilities_;
+            std::vector<u64> threshold_; //column kept if the low 32 bits are below this, in [0, 2^32]
+            std::vector<IntType> alias_;
+
+            constexpr void build() {
+                if(probabilities_.empty()){
+                    probabilities_.push_back(1.0);
+                }
+                double sum = 0.0;
+                for(double w : probabilities_){
+                    assert(w >= 0.0 && "discrete_distribution: weights must be non-negative.");
+                    sum += w;
+                }
+                assert(sum > 0.0 && "discrete_distribution: at least one weight must be positive.");
+                const std::size_t n = probabilities_.size();
+                std::vector<double> scaled(n);
+                for(std::size_t i = 0; i < n; ++i){
+                    probabilities_[i] /= sum;
+                    scaled[i] = probabilities_[i] * static_cast<double>(n);
+                }
+                threshold_.assign(n, u64(1) << 32);
+                alias_.resize(n);
+                std::vector<std::size_t> small, large;
+                for(std::size_t i = n; i-- > 0;){
+                    (scaled[i] < 1.0 ? small : large).push_back(i);
+                }
+                while(!small.empty() && !large.empty()){
+                    const std::size_t less = small.back();
+                    const std::size_t more = large.back();
+                    small.pop_back();
+                    large.pop_back();
+                    threshold_[less] = static_cast<u64>(scaled[less] * 0x1.0p32);
+                    alias_[less] = static_cast<IntType>(more);
+                    scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+                    (scaled[more] < 1.0 ? small : large).push_back(more);
+                }
+                for(std::size_t i = 0; i < n; ++i){ //leftovers are 1.0 up to rounding
+                    alias_[i] = (threshold_[i] == (u64(1) << 32)) ? static_cast<IntType>(i) : alias_[i];
+                }
+            }
+        };
+
+        constexpr discrete_distribution() : p_() {}
+        template<std::input_iterator It>
+        constexpr discrete_distribution(It first, It last) : p_(first, last) {}
+        constexpr discrete_distribution(std::initializer_list<double> weights) : p_(weights) {}
+        template<typename UnaryOperation>
+        constexpr discrete_distribution(std::size_t count, double xmin, double xmax, UnaryOperation fw) : p_(count, xmin, xmax, fw) {}
+        constexpr explicit discrete_distribution(const param_type& p) : p_(p) {}
+
+        constexpr void reset() noexcept {}
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g) noexcept {
+            return (*this)(g, p_);
+        }
+
+        template<full_range_engine G>
+        constexpr result_type operator()(G& g, const param_type& p) noexcept {
+            const u64 n = p.threshold_.size();
+            u64 bits = bits64(g);
+            u64 m = (bits >> 32) * n;
+            if(static_cast<u32>(m) < n){
+                const auto reject_below = static_cast<u32>((u64(1) << 32) % n);
+                while(static_cast<u32>(m) < reject_below){
+                    bits = bits64(g);
+                    m = (bits >> 32) * n;
+                }
+            }
+            const auto column = static_cast<std::size_t>(m >> 32);
+            return ((bits & 0xFFFFFFFF) < p.threshold_[column]) ? static_cast<IntType>(column) : p.alias_[column];
+        }
+
+        template<full_range_engine G>
+        constexpr void fill(std::span<result_type> out, G& g) noexcept {
+            for(auto& x : out){
+                x = (*this)(g, p_);
+            }
+        }
+
+        constexpr std::vector<double> probabilities() const { return p_.probabilities(); }
+        constexpr param_type param() const { return p_; }
+        constexpr void param(const param_type& p) { p_ = p; }
+        constexpr result_type min() const noexcept { return 0; }
+        constexpr result_type max() const noexcept { return static_cast<result_type>(p_.threshold_.size() - 1); }
+        constexpr bool operator==(const discrete_distribution&) const noexcept = default;
+    private:
+        param_type p_;
+    };
+}
+PORTABLE_FP_END
+
+/* Example usage:
+#include "SmallFast_64.h"
+#include "distributions.hpp"
+
+int main() {
+    SmallFast64 rng(12345);
+    portable::exponential_distribution<float> arrival(0.5f); // mean time between events: 2.0
+    portable::poisson_distribution<int> drops(3.5);          // mean 3.5 dropped packets per tick
+    portable::binomial_distribution<int> hits(20, 0.3);      // 20 shots at 30% hit chance
+    portable::uniform_int_distribution<int> d20(1, 20);
+    portable::normal_distribution<float> height(170.0f, 10.0f);
+    portable::discrete_distribution<int> loot{70.0, 25.0, 4.5, 0.5}; // common, rare, epic, legendary
+    int roll = d20(rng) + loot(rng);
+    float h = height(rng);
+
+    float next_event = arrival(rng);
+    int dropped = drops(rng);
+
+    std::array<int, 1024> volley{};
+    hits.fill(volley, rng); // same output on every compiler and platform
+
+    // economy tick: price shocks and how each agent splits its output between three resources
+    portable::gamma_distribution<float> shock(2.0f, 0.05f);     // shape 2, mean 0.1
+    portable::dirichlet_distribution<float> split{0.5, 2.0, 4.0};
+    std::vector<float> shocks(100000), splits(100000 * split.size());
+    shock.fill(shocks, rng);
+    split.fill(splits, rng);                                 // 3 weights per agent, summing to 1
+
+    // also at compile time
+    constexpr int compile_time_drops = []{
+        SmallFast64 r(42);
+        portable::poisson_distribution<int> d(100.0);
+        return d(r);
+    }();
+    return roll + dropped + volley[0] + compile_time_drops + static_cast<int>(next_event + h + shocks[0] + splits[0]);
+}
+*/
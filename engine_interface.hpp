@@ -0,0 +1,159 @@
+#pragma once
+#include <cassert>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include "portable_math.hpp"
+#include "seed.hpp"
+#include "ziggurat.hpp"
+// The shared high-level interface of every engine in this repo.
+//
+// An engine implements one function, next(), returning full-range 32- or 64-bit output. Deriving from
+// engine_interface<Engine, u32 or u64> then provides, with the width chosen at compile time:
+//   operator(), min(), max(), result_type  - UniformRandomBitGenerator, for std::shuffle and friends
+//   next(bound), operator()(bound)         - [0, bound), Lemire's unbiased multiply-and-reject
+//   next_bounded(bounds, out)              - out[i] in [0, bounds[i]), many 16-bit bounded values per 64-bit draw
+//   between(min, max)                      - integers in [min, max] inclusive, floats in [min, max)
+//   normalized<T = float>()                - [0, 1), 24 bits for float and 53 bits for double
+//   unit_range<T = float>()                - [-1, 1)
+//   coinToss()                             - the top bit, the strongest one in every engine here
+//   next_gaussian<T = float>(mean, stddev) - the 256-layer ziggurat from ziggurat.hpp, no hidden state
+//   fill(span)                             - bulk output
+//   discard(n)
+//   split()                                - an independent child generator, for fork-join task trees
+// All of it is constexpr and deterministic across platforms (see portable_math.hpp).
+//
+// A new engine is about 20 lines:
+//   class MyEngine : public engine_interface<MyEngine, std::uint64_t> {
+//   public:
+//       using engine_interface::next; //next(bound), hidden by our next() otherwise
+//       constexpr explicit MyEngine(u64 seed) noexcept : s(seed) {}
+//       constexpr result_type next() noexcept { ... }
+//   private:
+//       u64 s;
+//   };
+// Engines can still override any method with something better for their structure, like PCG32's
+// O(log n) discard().
+PORTABLE_FP_BEGIN
+template<typename E>
+concept random_engine = portable::full_range_engine<E> && requires(E& e) {
+    { e.next() } -> std::same_as<typename E::result_type>;
+};
+
+template<typename Derived, std::unsigned_integral Result>
+    requires (sizeof(Result) == 4 || sizeof(Result) == 8)
+class engine_interface {
+public:
+    using result_type = Result;
+
+    static constexpr result_type min() noexcept {
+        return 0;
+    }
+
+    static constexpr result_type max() noexcept {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    constexpr result_type operator()() noexcept {
+        return self().next();
+    }
+
+    // [0, bound), bound > 0
+    constexpr result_type next(result_type bound) noexcept {
+        assert(bound > 0 && "engine_interface::next(bound) called with an empty range.");
+        return static_cast<result_type>(portable::bounded(self(), bound));
+    }
+
+    constexpr result_type operator()(result_type bound) noexcept {
+        return next(bound);
+    }
+
+    // out[i] in [0, bounds[i]), for mixed dice pools (d6, d8, d20, ...): Lemire's batched draws pack as many
+    // values into each 64-bit draw as the bounds allow, see portable::bounded_batch
+    constexpr void next_bounded(std::span<const std::uint16_t> bounds, std::span<std::uint16_t> out) noexcept {
+        portable::bounded_batch(self(), bounds, out);
+    }
+
+    // every out[i] in [0, bound), with a vectorized bulk path
+    constexpr void next_bounded(std::uint16_t bound, std::span<std::uint16_t> out) noexcept {
+        portable::bounded_batch(self(), bound, out);
+    }
+
+    constexpr bool coinToss() noexcept {
+        return (self().next() >> (std::numeric_limits<result_type>::digits - 1)) != 0;
+    }
+
+    // integers: [min, max] inclusive, any width (wider than result_type takes two draws).
+    // floating point: [min, max)
+    template<typename T>
+    constexpr T between(T min, T max) noexcept {
+        if constexpr(std::is_floating_point_v<T>){
+            assert(min < max && "engine_interface::between(min, max) called with inverted range.");
+            return min + (max - min) * normalized<T>();
+        } else {
+            static_assert(std::is_integral_v<T>, "engine_interface::between only supports integral and floating point types.");
+            assert(min <= max && "engine_interface::between(min, max) called with inverted range.");
+            using UT = std::make_unsigned_t<T>;
+            const auto range = static_cast<std::uint64_t>(static_cast<UT>(static_cast<UT>(max) - static_cast<UT>(min)));
+            const std::uint64_t offset = (range == std::numeric_limits<std::uint64_t>::max())
+                ? portable::bits64(self())
+                : portable::bounded(self(), range + 1);
+            return static_cast<T>(static_cast<UT>(static_cast<UT>(min) + static_cast<UT>(offset)));
+        }
+    }
+
+    // [0, 1)
+    template<typename T = float>
+    constexpr T normalized() noexcept {
+        static_assert(std::is_floating_point_v<T>, "engine_interface::normalized can only be used with floating point types.");
+        return portable::uniform01<T>(self());
+    }
+
+    // [-1, 1)
+    template<typename T = float>
+    constexpr T unit_range() noexcept {
+        static_assert(std::is_floating_point_v<T>, "engine_interface::unit_range can only be used with floating point types.");
+        return static_cast<T>(2.0) * normalized<T>() - static_cast<T>(1.0);
+    }
+
+    template<typename T = float>
+    constexpr T next_gaussian(T mean, T stddev) noexcept {
+        static_assert(std::is_floating_point_v<T>, "engine_interface::next_gaussian can only be used with floating point types.");
+        return mean + stddev * static_cast<T>(portable::ziggurat::normal(self()));
+    }
+
+    // out.size() consecutive outputs. Engines with a real bulk kernel override this.
+    constexpr void fill(std::span<result_type> out) noexcept {
+        Derived copy = self(); //a local copy stays in registers, the stores to out can't alias it
+        for(auto& v : out){
+            v = copy.next();
+        }
+        self() = copy;
+    }
+
+    constexpr void discard(std::uint64_t count) noexcept {
+        for(std::uint64_t i = 0; i < count; ++i){
+            self().next();
+        }
+    }
+
+    // A statistically independent child generator, seeded from seed::splitmix64 of the next 64 bits
+    // of output. The parent advances, so repeated splits give distinct children. The result depends
+    // only on the parent's state: a task tree that splits in program order gets the same generators
+    // however its tasks are scheduled, without knowing the fan-out in advance.
+    constexpr Derived split() noexcept requires std::constructible_from<Derived, std::uint64_t> {
+        return Derived(seed::splitmix64(portable::bits64(self())));
+    }
+
+    // stateless, lets engines default their own comparisons
+    constexpr auto operator<=>(const engine_interface&) const noexcept = default;
+
+private:
+    constexpr Derived& self() noexcept {
+        return static_cast<Derived&>(*this);
+    }
+};
+PORTABLE_FP_END
@@ -0,0 +1,359 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include "portable_math.hpp"
+// Rejection-free geometric sampling for particles, ballistics and procedural placement.
+//
+// The usual unit_range() rejection loops cost two draws and a 21% rejection rate per point in a disc,
+// and about half the draws are thrown away in a sphere. Every sampler here maps a fixed number of
+// random bits straight to a point instead:
+//   on_circle    - one 32-bit draw: the angle
+//   in_disc      - one 64-bit draw: angle and sqrt(u) radius
+//   on_sphere    - one 64-bit draw: Archimedes' cylindrical projection (uniform z, uniform angle)
+//   in_sphere    - on_sphere plus one 32-bit draw for the cbrt(u) radius
+//   in_triangle  - one 64-bit draw: two barycentric coordinates, folded back into the triangle
+//   in_box       - one 32-bit draw per axis, 2D boxes pair them in one 64-bit draw
+// (a 64-bit draw is one next() on 64-bit engines and two on 32-bit engines.)
+//
+// The angle goes through a polynomial sincos on one quadrant, with the quadrant picked by the top two
+// bits, so there are no branches and no std::sin / std::cos: like the rest of portable_math.hpp, the
+// results are the same on every platform.
+//
+// The bulk overloads write SoA output (span<float> xs, ys, zs) for emitters spawning millions of
+// points. They draw the bits for a block of points first, which is the serial part, and then run the
+// branchless math over the block in a loop the compiler vectorizes. They produce exactly the points
+// the scalar functions would, in the same order.
+PORTABLE_FP_BEGIN
+namespace geometry {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    struct vec2 {
+        float x, y;
+        constexpr bool operator==(const vec2&) const noexcept = default;
+    };
+
+    struct vec3 {
+        float x, y, z;
+        constexpr bool operator==(const vec3&) const noexcept = default;
+    };
+
+    namespace detail {
+        inline constexpr std::size_t BLOCK = 256; //points per bulk block
+
+        // 24 bits to float. Through int32, which has a vector conversion where uint32 doesn't.
+        constexpr float to_float(u32 bits24) noexcept {
+            return static_cast<float>(static_cast<std::int32_t>(bits24));
+        }
+
+        // [0, 1) from the top 24 bits
+        constexpr float unit(u32 bits) noexcept {
+            return to_float(bits >> 8) * 0x1.0p-24f;
+        }
+
+        // (0, 1], never 0
+        constexpr float unit_open(u32 bits) noexcept {
+            return to_float((bits >> 8) + 1) * 0x1.0p-24f;
+        }
+
+        // condition ? a : b with bit masks. The conditions here are coin flips, a branch would
+        // mispredict half the time, and masks keep the bulk loops vectorizable.
+        constexpr float select(bool condition, float a, float b) noexcept {
+            const u32 mask = 0u - static_cast<u32>(condition);
+            return std::bit_cast<float>((std::bit_cast<u32>(a) & mask) | (std::bit_cast<u32>(b) & ~mask));
+        }
+
+        // sqrt of x in [0, 1], as x / sqrt(x): a bit-level estimate of the reciprocal square root and three
+        // Newton steps, a few ulp off. Only + - *, so no errno path (std::sqrt keeps the loops from
+        // vectorizing unless built with -fno-math-errno), and 0 maps to 0.
+        constexpr float sqrt(float x) noexcept {
+            float y = std::bit_cast<float>(0x5F375A86u - (std::bit_cast<u32>(x) >> 1));
+            y = y * (1.5f - 0.5f * x * y * y); //written out: the bulk loops can't vectorize around inner loops
+            y = y * (1.5f - 0.5f * x * y * y);
+            y = y * (1.5f - 0.5f * x * y * y);
+            return x * y;
+        }
+
+        // cube root of x in (0, 1]: bit-level estimate, then three Newton steps
+        constexpr float cbrt(float x) noexcept {
+            float y = std::bit_cast<float>(std::bit_cast<u32>(x) / 3 + 0x2A5137A0u);
+            y = (2.0f * y + x / (y * y)) * (1.0f / 3.0f);
+            y = (2.0f * y + x / (y * y)) * (1.0f / 3.0f);
+            y = (2.0f * y + x / (y * y)) * (1.0f / 3.0f);
+            return y;
+        }
+
+        // (cos, sin) of bits / 2^32 turns. The top two bits pick the quadrant, the next 24 the angle
+        // within it, evaluated with Taylor polynomials on [0, pi/2] (error below 1e-7).
+        constexpr vec2 cos_sin(u32 bits) noexcept {
+            const u32 quadrant = bits >> 30;
+            const float x = to_float((bits >> 6) & 0xFFFFFFu) * (0x1.0p-24f * 1.57079632679489662f);
+            const float x2 = x * x;
+            const float s = x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f
+                + x2 * (1.0f / 362880.0f + x2 * (-1.0f / 39916800.0f))))));
+            const float c = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24.0f + x2 * (-1.0f / 720.0f + x2 * (1.0f / 40320.0f
+                + x2 * (-1.0f / 3628800.0f + x2 * (1.0f / 479001600.0f))))));
+            //rotate by quadrant * 90 degrees: (c, s) (-s, c) (-c, -s) (s, -c)
+            const bool odd = (quadrant & 1u) != 0;
+            const u32 out_x = std::bit_cast<u32>(select(odd, s, c)) ^ (((quadrant + 1u) & 2u) << 30); //flip the sign bit
+            const u32 out_y = std::bit_cast<u32>(select(odd, c, s)) ^ ((quadrant & 2u) << 30);
+            return {std::bit_cast<float>(out_x), std::bit_cast<float>(out_y)};
+        }
+
+        // The random bits for one point, as 32-bit words: one 32-bit draw, one 64-bit draw (high word
+        // first), or a 64-bit and a 32-bit draw.
+        template<std::size_t N>
+        using words = std::array<u32, N>;
+
+        template<portable::full_range_engine G>
+        constexpr words<1> draw32(G& g) noexcept {
+            return {portable::bits32(g)};
+        }
+
+        template<portable::full_range_engine G>
+        constexpr words<2> draw64(G& g) noexcept {
+            const u64 b = portable::bits64(g);
+            return {static_cast<u32>(b >> 32), static_cast<u32>(b)};
+        }
+
+        template<portable::full_range_engine G>
+        constexpr words<3> draw96(G& g) noexcept {
+            const words<2> w = draw64(g);
+            return {w[0], w[1], portable::bits32(g)};
+        }
+
+        // The point kernels, from raw bits. Shared by the scalar and the bulk functions.
+        constexpr vec2 circle(u32 a) noexcept {
+            return cos_sin(a);
+        }
+
+        constexpr vec2 disc(u32 angle, u32 radius) noexcept {
+            const vec2 d = cos_sin(angle);
+            const float r = sqrt(unit(radius));
+            return {r * d.x, r * d.y};
+        }
+
+        constexpr vec3 sphere(u32 angle, u32 height) noexcept {
+            const float z = 1.0f - 2.0f * unit(height); //(-1, 1]
+            const float r2 = 1.0f - z * z;
+            const float r = sqrt(select(r2 > 0.0f, r2, 0.0f));
+            const vec2 d = cos_sin(angle);
+            return {r * d.x, r * d.y, z};
+        }
+
+        constexpr vec3 ball(u32 angle, u32 height, u32 radius) noexcept {
+            const vec3 p = sphere(angle, height);
+            const float r = cbrt(unit_open(radius));
+            return {r * p.x, r * p.y, r * p.z};
+        }
+
+        // barycentric (u, v) uniform in the triangle u + v <= 1
+        constexpr vec2 barycentric(u32 bits_u, u32 bits_v) noexcept {
+            float u = unit(bits_u);
+            float v = unit(bits_v);
+            const bool outside = u + v > 1.0f; //fold the other half of the unit square back in
+            u = select(outside, 1.0f - u, u);
+            v = select(outside, 1.0f - v, v);
+            return {u, v};
+        }
+
+        // The bulk loop: the bits for a block of points, then the math over the block into local SoA
+        // arrays, then a copy out. The local arrays can't alias each other or the engine, which is
+        // what lets the compiler vectorize the math without runtime overlap checks, and the bits are
+        // stored as 32-bit words because loops mixing 64-bit integers and floats don't vectorize at -O2.
+        // draw(g) returns the words for one point, kernel(words) the point.
+        template<std::size_t N, portable::full_range_engine G, typename Draw, typename Kernel>
+        void bulk(G& g, std::span<float> xs, std::span<float> ys, std::span<float> zs, Draw&& draw, Kernel&& kernel) noexcept {
+            using point = decltype(kernel(words<N>{}));
+            std::array<std::array<u32, BLOCK>, N> bits{};
+            std::array<float, BLOCK> bx, by, bz;
+            for(std::size_t first = 0; first < xs.size(); first += BLOCK){
+                const std::size_t n = (xs.size() - first < BLOCK) ? xs.size() - first : BLOCK;
+                for(std::size_t i = 0; i < n; ++i){
+                    const words<N> w = draw(g);
+                    for(std::size_t k = 0; k < N; ++k){
+                        bits[k][i] = w[k];
+                    }
+                }
+                for(std::size_t i = 0; i < BLOCK; ++i){ //the whole block, a fixed trip count needs no scalar tail
+                    words<N> w;
+                    for(std::size_t k = 0; k < N; ++k){
+                        w[k] = bits[k][i];
+                    }
+                    const point p = kernel(w);
+                    bx[i] = p.x;
+                    by[i] = p.y;
+                    if constexpr(std::is_same_v<point, vec3>){
+                        bz[i] = p.z;
+                    }
+                }
+                std::copy_n(bx.data(), n, xs.data() + first);
+                std::copy_n(by.data(), n, ys.data() + first);
+                if constexpr(std::is_same_v<point, vec3>){
+                    std::copy_n(bz.data(), n, zs.data() + first);
+                }
+            }
+        }
+
+        // The samplers from a point's words, shared by the scalar and the bulk functions
+        constexpr vec2 on_circle(words<1> w) noexcept {
+            return circle(w[0]);
+        }
+
+        constexpr vec2 in_disc(words<2> w) noexcept {
+            return disc(w[1], w[0]); //angle from the low word, radius from the high
+        }
+
+        constexpr vec3 on_sphere(words<2> w) noexcept {
+            return sphere(w[1], w[0]);
+        }
+
+        constexpr vec3 in_sphere(words<3> w) noexcept {
+            return ball(w[1], w[0], w[2]);
+        }
+
+        constexpr vec2 in_triangle(words<2> w, vec2 a, vec2 b, vec2 c) noexcept {
+            const vec2 uv = barycentric(w[0], w[1]);
+            return {a.x + uv.x * (b.x - a.x) + uv.y * (c.x - a.x), a.y + uv.x * (b.y - a.y) + uv.y * (c.y - a.y)};
+        }
+
+        constexpr vec3 in_triangle(words<2> w, vec3 a, vec3 b, vec3 c) noexcept {
+            const vec2 uv = barycentric(w[0], w[1]);
+            return {a.x + uv.x * (b.x - a.x) + uv.y * (c.x - a.x),
+                    a.y + uv.x * (b.y - a.y) + uv.y * (c.y - a.y),
+                    a.z + uv.x * (b.z - a.z) + uv.y * (c.z - a.z)};
+        }
+
+        constexpr vec2 in_box(words<2> w, vec2 lo, vec2 hi) noexcept {
+            return {lo.x + (hi.x - lo.x) * unit(w[0]), lo.y + (hi.y - lo.y) * unit(w[1])};
+        }
+
+        constexpr vec3 in_box(words<3> w, vec3 lo, vec3 hi) noexcept {
+            return {lo.x + (hi.x - lo.x) * unit(w[0]), lo.y + (hi.y - lo.y) * unit(w[1]), lo.z + (hi.z - lo.z) * unit(w[2])};
+        }
+    }
+
+    // on the unit circle
+    template<portable::full_range_engine G>
+    constexpr vec2 on_circle(G& g) noexcept {
+        return detail::on_circle(detail::draw32(g));
+    }
+
+    // in the unit disc
+    template<portable::full_range_engine G>
+    constexpr vec2 in_disc(G& g) noexcept {
+        return detail::in_disc(detail::draw64(g));
+    }
+
+    // on the unit sphere
+    template<portable::full_range_engine G>
+    constexpr vec3 on_sphere(G& g) noexcept {
+        return detail::on_sphere(detail::draw64(g));
+    }
+
+    // in the unit ball
+    template<portable::full_range_engine G>
+    constexpr vec3 in_sphere(G& g) noexcept {
+        return detail::in_sphere(detail::draw96(g));
+    }
+
+    // in the triangle abc
+    template<portable::full_range_engine G>
+    constexpr vec2 in_triangle(G& g, vec2 a, vec2 b, vec2 c) noexcept {
+        return detail::in_triangle(detail::draw64(g), a, b, c);
+    }
+
+    template<portable::full_range_engine G>
+    constexpr vec3 in_triangle(G& g, vec3 a, vec3 b, vec3 c) noexcept {
+        return detail::in_triangle(detail::draw64(g), a, b, c);
+    }
+
+    // in the box [lo, hi)
+    template<portable::full_range_engine G>
+    constexpr vec2 in_box(G& g, vec2 lo, vec2 hi) noexcept {
+        return detail::in_box(detail::draw64(g), lo, hi);
+    }
+
+    template<portable::full_range_engine G>
+    constexpr vec3 in_box(G& g, vec3 lo, vec3 hi) noexcept {
+        return detail::in_box(detail::draw96(g), lo, hi);
+    }
+
+    // Bulk SoA versions: point i goes to (xs[i], ys[i], zs[i]). The spans must be the same size.
+
+    template<portable::full_range_engine G>
+    void on_circle(G& g, std::span<float> xs, std::span<float> ys) noexcept {
+        assert(xs.size() == ys.size() && "geometry::on_circle: output spans differ in size.");
+        detail::bulk<1>(g, xs, ys, {}, [](G& e){ return detail::draw32(e); }, [](detail::words<1> w){ return detail::on_circle(w); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_disc(G& g, std::span<float> xs, std::span<float> ys) noexcept {
+        assert(xs.size() == ys.size() && "geometry::in_disc: output spans differ in size.");
+        detail::bulk<2>(g, xs, ys, {}, [](G& e){ return detail::draw64(e); }, [](detail::words<2> w){ return detail::in_disc(w); });
+    }
+
+    template<portable::full_range_engine G>
+    void on_sphere(G& g, std::span<float> xs, std::span<float> ys, std::span<float> zs) noexcept {
+        assert(xs.size() == ys.size() && xs.size() == zs.size() && "geometry::on_sphere: output spans differ in size.");
+        detail::bulk<2>(g, xs, ys, zs, [](G& e){ return detail::draw64(e); }, [](detail::words<2> w){ return detail::on_sphere(w); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_sphere(G& g, std::span<float> xs, std::span<float> ys, std::span<float> zs) noexcept {
+        assert(xs.size() == ys.size() && xs.size() == zs.size() && "geometry::in_sphere: output spans differ in size.");
+        detail::bulk<3>(g, xs, ys, zs, [](G& e){ return detail::draw96(e); }, [](detail::words<3> w){ return detail::in_sphere(w); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_triangle(G& g, vec2 a, vec2 b, vec2 c, std::span<float> xs, std::span<float> ys) noexcept {
+        assert(xs.size() == ys.size() && "geometry::in_triangle: output spans differ in size.");
+        detail::bulk<2>(g, xs, ys, {}, [](G& e){ return detail::draw64(e); }, [=](detail::words<2> w){ return detail::in_triangle(w, a, b, c); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_triangle(G& g, vec3 a, vec3 b, vec3 c, std::span<float> xs, std::span<float> ys, std::span<float> zs) noexcept {
+        assert(xs.size() == ys.size() && xs.size() == zs.size() && "geometry::in_triangle: output spans differ in size.");
+        detail::bulk<2>(g, xs, ys, zs, [](G& e){ return detail::draw64(e); }, [=](detail::words<2> w){ return detail::in_triangle(w, a, b, c); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_box(G& g, vec2 lo, vec2 hi, std::span<float> xs, std::span<float> ys) noexcept {
+        assert(xs.size() == ys.size() && "geometry::in_box: output spans differ in size.");
+        detail::bulk<2>(g, xs, ys, {}, [](G& e){ return detail::draw64(e); }, [=](detail::words<2> w){ return detail::in_box(w, lo, hi); });
+    }
+
+    template<portable::full_range_engine G>
+    void in_box(G& g, vec3 lo, vec3 hi, std::span<float> xs, std::span<float> ys, std::span<float> zs) noexcept {
+        assert(xs.size() == ys.size() && xs.size() == zs.size() && "geometry::in_box: output spans differ in size.");
+        detail::bulk<3>(g, xs, ys, zs, [](G& e){ return detail::draw96(e); }, [=](detail::words<3> w){ return detail::in_box(w, lo, hi); });
+    }
+}
+PORTABLE_FP_END
+
+/* Example usage:
+#include <vector>
+#include "geometry.hpp"
+#include "SmallFast_64.h"
+
+int main() {
+    SmallFast64 rng(42);
+    geometry::vec3 spark = geometry::on_sphere(rng);       //a direction, no rejection loop
+    geometry::vec2 spread = geometry::in_disc(rng);        //a shotgun pellet offset
+
+    // an emitter: 10M points straight into SoA particle buffers
+    std::vector<float> xs(10'000'000), ys(xs.size()), zs(xs.size());
+    geometry::in_sphere(rng, xs, ys, zs);
+
+    // spawn on a mesh face
+    geometry::vec3 a{0, 0, 0}, b{1, 0, 0}, c{0, 1, 0};
+    geometry::vec3 p = geometry::in_triangle(rng, a, b, c);
+    return static_cast<int>(spark.z + spread.x + p.x + xs[0]);
+}
+*/
@@ -0,0 +1,535 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "engine_interface.hpp"
+// Per-call-site draw counters, for finding where RNG time goes in a real program.
+//
+// instrumented<Engine> wraps an engine like buffered.hpp does and is a full engine itself
+// (engine_interface), producing the same values as Engine for every method of the shared interface.
+// Each drawing method takes a defaulted std::source_location, so call sites don't change, and counts
+// per call site (file, line, method):
+//   calls      - how often the site was called
+//   draws      - engine steps spent, including the retries of Lemire's rejection in next(bound) and
+//                between(), and of the ziggurat's wedge and tail in next_gaussian
+//   retries    - draws beyond the fewest one call at the site needed (its min_draws). With draws per
+//                call it shows which sites pay for rejection loops; next(bound) at a bound just above
+//                a power of two is the usual culprit
+//   max_draws  - the worst single call
+// and, with PRNG_PERF_EVENTS=1 on Linux, the CPU cycles of the bulk calls (fill, discard and
+// next_bounded), read from a perf_event_open counter of the calling thread before and after. The
+// counter is two syscalls per bulk call, too slow for single draws, and it needs perf_event_paranoid
+// <= 2 (or CAP_PERFMON); where it can't be opened the cycle columns stay 0.
+//
+// Counters are thread-local, so counting is a few plain stores to memory no other core writes.
+// instrumentation::report() aggregates every thread's counters, live threads' and those that have
+// exited, on demand from any thread; instrumentation::write() prints them as a flat table, hottest
+// call site first.
+//
+// Engine-specific methods beyond the shared interface (SmallFast64::next_2, RNG's floating point
+// inRange, ...) are not offered: they draw through the wrapped engine, where they can't be counted.
+// The integer inRange(range) and uniformRandom(range) of RNG are the same Lemire draw as next(range),
+// so they are offered where the engine has them, counted with their retries.
+//
+// Switch with PRNG_INSTRUMENT: 0 (default) makes instrumentation::counted<Engine> a plain alias of
+// Engine, so release builds pay nothing. 1 makes it an instrumented<Engine>.
+#ifndef PRNG_INSTRUMENT
+#define PRNG_INSTRUMENT 0
+#endif
+#ifndef PRNG_PERF_EVENTS
+#define PRNG_PERF_EVENTS 0
+#endif
+#if PRNG_PERF_EVENTS && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace instrumentation {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    enum class method : std::uint8_t {
+        next, next_bounded, between, normalized, unit_range, coin_toss, gaussian, bounded_batch, fill, discard, split,
+        in_range, uniform_random
+    };
+
+    inline const char* to_string(method m) noexcept {
+        constexpr std::array<const char*, 13> names{
+            "next", "next(bound)", "between", "normalized", "unit_range", "coinToss", "next_gaussian", "next_bounded", "fill", "discard", "split",
+            "inRange", "uniformRandom"
+        };
+        const auto i = static_cast<std::size_t>(m);
+        return i < names.size() ? names[i] : "unknown";
+    }
+
+    // one call site, all threads
+    struct site_report {
+        std::string file;
+        std::string function;
+        u32 line = 0;
+        method kind = method::next;
+        u64 calls = 0;
+        u64 draws = 0;
+        u64 min_draws = 0;  //per call
+        u64 max_draws = 0;  //per call
+        u64 cycles = 0;     //bulk calls with PRNG_PERF_EVENTS only
+        u64 timed_calls = 0;
+
+        u64 retries() const noexcept { return draws - calls * min_draws; }
+        double draws_per_call() const noexcept { return calls ? static_cast<double>(draws) / static_cast<double>(calls) : 0.0; }
+        double cycles_per_call() const noexcept { return timed_calls ? static_cast<double>(cycles) / static_cast<double>(timed_calls) : 0.0; }
+    };
+
+    namespace detail {
+        // The counters of one call site on one thread. Only the owning thread writes (relaxed loads and
+        // stores, no read-modify-write); report() reads them from other threads.
+        struct slot {
+            std::atomic<const char*> file{nullptr}; //set last: a slot with a file is complete
+            const char* function = nullptr;
+            u32 line = 0;
+            method kind = method::next;
+            std::atomic<u64> calls{0};
+            std::atomic<u64> draws{0};
+            std::atomic<u64> min_draws{std::numeric_limits<u64>::max()};
+            std::atomic<u64> max_draws{0};
+            std::atomic<u64> cycles{0};
+            std::atomic<u64> timed_calls{0};
+
+            void add(u64 n) noexcept {
+                bump(calls, 1);
+                bump(draws, n);
+                if(n < min_draws.load(std::memory_order_relaxed)){ min_draws.store(n, std::memory_order_relaxed); }
+                if(n > max_draws.load(std::memory_order_relaxed)){ max_draws.store(n, std::memory_order_relaxed); }
+            }
+
+            void add_cycles(u64 c) noexcept {
+                bump(cycles, c);
+                bump(timed_calls, 1);
+            }
+
+            static void bump(std::atomic<u64>& counter, u64 n) noexcept {
+                counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            site_report read() const {
+                site_report r;
+                r.file = file.load(std::memory_order_acquire);
+                r.function = function;
+                r.line = line;
+                r.kind = kind;
+                r.calls = calls.load(std::memory_order_relaxed);
+                r.draws = draws.load(std::memory_order_relaxed);
+                r.min_draws = r.calls ? min_draws.load(std::memory_order_relaxed) : 0;
+                r.max_draws = max_draws.load(std::memory_order_relaxed);
+                r.cycles = cycles.load(std::memory_order_relaxed);
+                r.timed_calls = timed_calls.load(std::memory_order_relaxed);
+                return r;
+            }
+        };
+
+        // the same call site, merged across threads (file name strings can differ in address per TU)
+        inline bool same_site(const site_report& a, const site_report& b) noexcept {
+            return a.line == b.line && a.kind == b.kind && a.file == b.file && a.function == b.function;
+        }
+
+        inline void merge(std::vector<site_report>& into, const site_report& r) {
+            const auto it = std::find_if(into.begin(), into.end(), [&](const site_report& x){ return same_site(x, r); });
+            if(it == into.end()){
+                into.push_back(r);
+                return;
+            }
+            it->min_draws = it->calls == 0 ? r.min_draws : (r.calls == 0 ? it->min_draws : std::min(it->min_draws, r.min_draws));
+            it->max_draws = std::max(it->max_draws, r.max_draws);
+            it->calls += r.calls;
+            it->draws += r.draws;
+            it->cycles += r.cycles;
+            it->timed_calls += r.timed_calls;
+        }
+
+        class thread_table;
+
+        // every live thread's table, and the totals of threads that have exited
+        struct registry {
+            std::mutex mutex;
+            std::vector<thread_table*> live;
+            std::vector<site_report> retired;
+        };
+
+        inline registry& global() {
+            static registry r;
+            return r;
+        }
+
+        // One thread's call sites: open addressing on (file, line, method), with one overflow
+        // slot when a thread has more than SLOTS sites.
+        class thread_table {
+        public:
+            static constexpr std::size_t SLOTS = 512;
+
+            thread_table() {
+                overflow_.function = "";
+                overflow_.file.store("<other call sites>", std::memory_order_relaxed);
+                registry& r = global(); //constructed first, so destroyed after every thread's table
+                std::lock_guard lock(r.mutex);
+                r.live.push_back(this);
+            }
+
+            ~thread_table() {
+                registry& r = global();
+                std::lock_guard lock(r.mutex);
+                r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+                collect(r.retired);
+            }
+
+            thread_table(const thread_table&) = delete;
+            thread_table& operator=(const thread_table&) = delete;
+
+            slot& find(const std::source_location& loc, method kind) noexcept {
+                const char* file = loc.file_name();
+                const auto h = (reinterpret_cast<std::uintptr_t>(file) >> 3) ^ (u64(loc.line()) * 0x9E3779B97F4A7C15) ^ static_cast<u64>(kind);
+                for(std::size_t probe = 0, i = static_cast<std::size_t>(h % SLOTS); probe < SLOTS; ++probe, i = (i + 1) % SLOTS){
+                    slot& s = slots_[i];
+                    const char* f = s.file.load(std::memory_order_relaxed);
+                    if(f == file && s.line == loc.line() && s.kind == kind){
+                        return s;
+                    }
+                    if(f == nullptr){
+                        s.function = loc.function_name();
+                        s.line = loc.line();
+                        s.kind = kind;
+                        s.file.store(file, std::memory_order_release);
+                        return s;
+                    }
+                }
+                return overflow_;
+            }
+
+            void collect(std::vector<site_report>& into) const {
+                for(const slot& s : slots_){
+                    if(s.file.load(std::memory_order_acquire) != nullptr){
+                        merge(into, s.read());
+                    }
+                }
+                if(overflow_.calls.load(std::memory_order_relaxed) != 0){
+                    merge(into, overflow_.read());
+                }
+            }
+
+        private:
+            std::array<slot, SLOTS> slots_{};
+            slot overflow_;
+        };
+
+        inline thread_table& local() {
+            thread_local thread_table table;
+            return table;
+        }
+
+#if PRNG_PERF_EVENTS && defined(__linux__)
+        // user-space cycles of the calling thread, on whichever CPU it runs
+        class cycle_counter {
+        public:
+            cycle_counter() noexcept {
+                perf_event_attr attr{};
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+            ~cycle_counter() {
+                if(fd_ >= 0){ ::close(fd_); }
+            }
+            cycle_counter(const cycle_counter&) = delete;
+            cycle_counter& operator=(const cycle_counter&) = delete;
+
+            bool available() const noexcept { return fd_ >= 0; }
+
+            u64 read() const noexcept {
+                u64 count = 0;
+                if(fd_ < 0 || ::read(fd_, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))){
+                    return 0;
+                }
+                return count;
+            }
+        private:
+            int fd_ = -1;
+        };
+
+        inline cycle_counter& cycles() {
+            thread_local cycle_counter counter;
+            return counter;
+        }
+#endif
+    }
+
+    // every thread's counters merged per call site, most draws first
+    inline std::vector<site_report> report() {
+        std::vector<site_report> out;
+        detail::registry& r = detail::global();
+        std::lock_guard lock(r.mutex);
+        for(const auto* table : r.live){
+            table->collect(out);
+        }
+        for(const auto& s : r.retired){
+            detail::merge(out, s);
+        }
+        std::sort(out.begin(), out.end(), [](const site_report& a, const site_report& b){ return a.draws > b.draws; });
+        return out;
+    }
+
+    // one row per call site: calls, draws, draws/call, retries, max draws, cycles/call (bulk calls with
+    // PRNG_PERF_EVENTS), tab-separated for spreadsheets and sort -t$'\t'
+    inline void write(std::ostream& os, const std::vector<site_report>& sites) {
+        os << "site\tmethod\tcalls\tdraws\tdraws/call\tretries\tmax draws\tcycles/call\tfunction\n";
+        for(const auto& s : sites){
+            os << s.file << ':' << s.line << '\t' << to_string(s.kind) << '\t' << s.calls << '\t' << s.draws << '\t'
+                << std::fixed << std::setprecision(3) << s.draws_per_call() << '\t' << s.retries() << '\t' << s.max_draws << '\t'
+                << std::setprecision(1) << s.cycles_per_call() << '\t' << s.function << '\n';
+        }
+    }
+}
+
+template<portable::full_range_engine Engine>
+class instrumented : public engine_interface<instrumented<Engine>,
+    std::conditional_t<Engine::max() == std::numeric_limits<std::uint32_t>::max(), std::uint32_t, std::uint64_t>> {
+public:
+    using base = engine_interface<instrumented<Engine>,
+        std::conditional_t<Engine::max() == std::numeric_limits<std::uint32_t>::max(), std::uint32_t, std::uint64_t>>;
+    using typename base::result_type;
+    using location = std::source_location;
+    using method = instrumentation::method;
+
+    template<typename... Args>
+        requires std::is_constructible_v<Engine, Args...>
+    explicit instrumented(Args&&... args) noexcept(std::is_nothrow_constructible_v<Engine, Args...>)
+        : engine_(std::forward<Args>(args)...) {}
+
+    // one engine step. Called from inside another method (next(bound) draws through it), it counts
+    // toward that call's draws.
+    result_type next(location loc = location::current()) noexcept {
+        if(in_call_){
+            ++draws_;
+            return static_cast<result_type>(engine_());
+        }
+        return count(method::next, loc, [&]{ return next(); });
+    }
+
+    result_type operator()(location loc = location::current()) noexcept {
+        return count(method::next, loc, [&]{ return next(); });
+    }
+
+    result_type next(result_type bound, location loc = location::current()) noexcept {
+        return count(method::next_bounded, loc, [&]{ return base::next(bound); });
+    }
+
+    result_type operator()(result_type bound, location loc = location::current()) noexcept {
+        return count(method::next_bounded, loc, [&]{ return base::next(bound); });
+    }
+
+    void next_bounded(std::span<const std::uint16_t> bounds, std::span<std::uint16_t> out, location loc = location::current()) noexcept {
+        count_bulk(method::bounded_batch, loc, [&]{ base::next_bounded(bounds, out); });
+    }
+
+    void next_bounded(std::uint16_t bound, std::span<std::uint16_t> out, location loc = location::current()) noexcept {
+        count_bulk(method::bounded_batch, loc, [&]{ base::next_bounded(bound, out); });
+    }
+
+    // [0, range), or (range, 0] for negative ranges, as RNG::inRange(range)
+    template<std::integral T>
+        requires requires(Engine& e, T range){ e.inRange(range); }
+    T inRange(T range, location loc = location::current()) noexcept {
+        assert(range != 0 && "instrumented::inRange called with an empty range.");
+        return count(method::in_range, loc, [&]{
+            using U = std::make_unsigned_t<T>;
+            const U magnitude = (range < 0) ? static_cast<U>(0 - static_cast<U>(range)) : static_cast<U>(range);
+            const auto n = static_cast<U>(portable::bounded(*this, static_cast<std::uint64_t>(magnitude)));
+            return (range < 0) ? static_cast<T>(0 - n) : static_cast<T>(n);
+        });
+    }
+
+    std::uint64_t uniformRandom(std::uint64_t range, location loc = location::current()) noexcept
+        requires requires(Engine& e){ e.uniformRandom(range); } {
+        assert(range != 0 && "instrumented::uniformRandom called with an empty range.");
+        return count(method::uniform_random, loc, [&]{ return portable::bounded(*this, range); });
+    }
+
+    bool coinToss(location loc = location::current()) noexcept {
+        return count(method::coin_toss, loc, [&]{ return base::coinToss(); });
+    }
+
+    template<typename T>
+    T between(T min, T max, location loc = location::current()) noexcept {
+        return count(method::between, loc, [&]{ return base::between(min, max); });
+    }
+
+    template<typename T = float>
+    T normalized(location loc = location::current()) noexcept {
+        return count(method::normalized, loc, [&]{ return base::template normalized<T>(); });
+    }
+
+    template<typename T = float>
+    T unit_range(location loc = location::current()) noexcept {
+        return count(method::unit_range, loc, [&]{ return base::template unit_range<T>(); });
+    }
+
+    template<typename T = float>
+    T next_gaussian(T mean, T stddev, location loc = location::current()) noexcept {
+        return count(method::gaussian, loc, [&]{ return base::next_gaussian(mean, stddev); });
+    }
+
+    // the wrapped engine's own bulk path, counted as out.size() draws
+    void fill(std::span<result_type> out, location loc = location::current()) noexcept {
+        count_bulk(method::fill, loc, [&]{
+            if constexpr(requires(Engine& e){ e.fill(out); }){
+                engine_.fill(out);
+            } else {
+                for(auto& v : out){
+                    v = static_cast<result_type>(engine_());
+                }
+            }
+            draws_ += out.size();
+        });
+    }
+
+    void discard(std::uint64_t count, location loc = location::current()) noexcept {
+        count_bulk(method::discard, loc, [&]{
+            engine_.discard(count);
+            draws_ += count;
+        });
+    }
+
+    instrumented split(location loc = location::current()) noexcept requires std::constructible_from<Engine, std::uint64_t> {
+        return count(method::split, loc, [&]{ return base::split(); });
+    }
+
+    const Engine& engine() const noexcept {
+        return engine_;
+    }
+
+    bool operator==(const instrumented& rhs) const noexcept {
+        return engine_ == rhs.engine_;
+    }
+
+private:
+    Engine engine_;
+    bool in_call_ = false;
+    std::uint64_t draws_ = 0;
+    // the last call site's slot, skips the hash lookup for calls in a loop
+    const char* last_file_ = nullptr;
+    std::uint32_t last_line_ = 0;
+    method last_kind_ = method::next;
+    instrumentation::detail::slot* last_slot_ = nullptr;
+    instrumentation::detail::thread_table* last_table_ = nullptr;
+
+    instrumentation::detail::slot& site(const location& loc, method kind) noexcept {
+        auto& table = instrumentation::detail::local();
+        if(last_slot_ == nullptr || last_table_ != &table || last_file_ != loc.file_name() || last_line_ != loc.line() || last_kind_ != kind){
+            last_slot_ = &table.find(loc, kind);
+            last_table_ = &table;
+            last_file_ = loc.file_name();
+            last_line_ = loc.line();
+            last_kind_ = kind;
+        }
+        return *last_slot_;
+    }
+
+    // Runs body as one call at loc and counts the engine steps it takes. Nested calls (unit_range
+    // calls normalized) count toward the outer one.
+    template<typename F>
+    auto count(method kind, const location& loc, F&& body) noexcept {
+        if(in_call_){
+            return body();
+        }
+        in_call_ = true;
+        draws_ = 0;
+        auto result = body();
+        in_call_ = false;
+        site(loc, kind).add(draws_);
+        return result;
+    }
+
+    template<typename F>
+    void count_bulk(method kind, const location& loc, F&& body) noexcept {
+        if(in_call_){
+            body();
+            return;
+        }
+        in_call_ = true;
+        draws_ = 0;
+#if PRNG_PERF_EVENTS && defined(__linux__)
+        auto& counter = instrumentation::detail::cycles();
+        const std::uint64_t start = counter.read();
+        body();
+        const std::uint64_t stop = counter.read();
+        in_call_ = false;
+        auto& s = site(loc, kind);
+        s.add(draws_);
+        if(counter.available()){
+            s.add_cycles(stop - start);
+        }
+#else
+        body();
+        in_call_ = false;
+        site(loc, kind).add(draws_);
+#endif
+    }
+};
+
+namespace instrumentation {
+#if PRNG_INSTRUMENT
+    template<typename Engine>
+    using counted = instrumented<Engine>;
+#else
+    template<typename Engine>
+    using counted = Engine;
+#endif
+}
+
+/* Example usage:
+// build with -DPRNG_INSTRUMENT=1 (and -DPRNG_PERF_EVENTS=1 for cycles of bulk calls)
+#include <iostream>
+#include <thread>
+#include "SmallFast_64.h"
+#include "instrumented.hpp"
+
+thread_local instrumentation::counted<SmallFast64> rng(1234); //the only line that changes
+
+int simulate() {
+    int hits = 0;
+    for(int i = 0; i < 100000; ++i){
+        hits += rng.next(1u << 20) == 0;                    //a power of two: never retries
+        hits += rng.next((1ull << 63) + 1) == 0;            //just above one: half the draws are retries
+        hits += rng.next_gaussian(0.0, 1.0) > 3.0;          //the ziggurat's rare wedge and tail retries
+    }
+    std::array<std::uint64_t, 4096> noise;
+    rng.fill(noise);
+    return hits;
+}
+
+int main() {
+    std::jthread worker(simulate);                          //counted on its own thread
+    simulate();
+    worker.join();
+#if PRNG_INSTRUMENT
+    instrumentation::write(std::cout, instrumentation::report());
+    // site                 method          calls   draws   draws/call  retries  max draws ...
+    // main.cpp:14          next(bound)     200000  399716  1.999       199716   23
+#endif
+}
+*/
@@ -0,0 +1,405 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "engine_interface.hpp"
+#include "seed.hpp"
+// Low-discrepancy sequences, for sampling where white noise converges too slowly: AO and area-light
+// rays, foliage and prop placement, stratified Monte Carlo. N points of a good sequence cover the
+// domain about as evenly as 4-16x as many independent random points.
+//
+//   Sobol<Dims>     - Dims <= 16, Joe & Kuo's direction numbers (new-joe-kuo-6.21201), built at compile
+//                     time. The best choice for power-of-two sample counts.
+//   Halton<Dims>    - Dims <= 16, the radical inverses in the first 16 prime bases, with the base a
+//                     compile-time constant so the digit loop divides by multiplication. Any count.
+//   Kronecker<Dims> - the R_d sequence (Martin Roberts, 2018): point n is frac(shift + n * alpha) with
+//                     alpha from the generalized golden ratio. One add per coordinate. R2 is Kronecker<2>.
+//
+// Each sequence is an engine (engine_interface, 64-bit output) whose next() walks the coordinates of
+// the current point, then moves to the next point: a loop that calls normalized() or between() once
+// per coordinate, Dims times per sample, gets the sequence in place of white noise with no other
+// changes. The output is the coordinate as 64-bit fixed point, so normalized<float>() and
+// normalized<double>() both take one next(). Things that use more than one draw per coordinate break
+// the stratification: next(bound) on the rare Lemire rejection, next_gaussian() on the ziggurat
+// fallback, and code that packs several coordinates into one 64-bit draw (geometry.hpp).
+//
+// Seeded with a number or an engine, the sequences are randomized while keeping their structure:
+// Sobol gets Owen scrambling by Laine & Karras' hash with Burley's constants ("Practical Hash-based
+// Owen Scrambling", 2020), Halton gets Owen scrambling with a hashed random digit shift per tree
+// node, and Kronecker gets a random shift per dimension (Cranley-Patterson rotation). Independently
+// seeded copies give unbiased, independent estimates, so split() works as for the other engines.
+// Default constructed, they are the plain textbook sequences.
+//
+// sample(index, dim) is random access to any coordinate. Sobol repeats after 2^32 points.
+namespace low_discrepancy {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    namespace detail {
+        inline constexpr std::size_t MAX_DIMENSIONS = 16;
+
+        constexpr u32 reverse_bits(u32 x) noexcept {
+            x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+            x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+            x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+            x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+            return (x >> 16) | (x << 16);
+        }
+
+        // Owen scrambling of a base-2 fraction: flipping a bit may only depend on the bits above it, which is
+        // a hash that only propagates upward. Laine & Karras' multiply-xor hash does that on reversed bits.
+        constexpr u32 owen_scramble(u32 x, u32 seed) noexcept {
+            x = reverse_bits(x);
+            x += seed;
+            x ^= x * 0x6c50b47cu;
+            x ^= x * 0xb82f1e52u;
+            x ^= x * 0xc7afe638u;
+            x ^= x * 0x8d22f6e6u;
+            return reverse_bits(x);
+        }
+
+        // Sobol direction numbers: primitive polynomial degree s, its coefficients a and the initial m_k
+        struct sobol_polynomial {
+            u32 s, a;
+            std::array<u32, 6> m;
+        };
+
+        inline constexpr std::array<sobol_polynomial, MAX_DIMENSIONS - 1> JOE_KUO{{
+            {1, 0, {1}},
+            {2, 1, {1, 3}},
+            {3, 1, {1, 3, 1}},
+            {3, 2, {1, 1, 1}},
+            {4, 1, {1, 1, 3, 3}},
+            {4, 4, {1, 3, 5, 13}},
+            {5, 2, {1, 1, 5, 5, 17}},
+            {5, 4, {1, 1, 5, 5, 5}},
+            {5, 7, {1, 1, 7, 11, 19}},
+            {5, 11, {1, 1, 5, 1, 1}},
+            {5, 13, {1, 1, 1, 3, 11}},
+            {5, 14, {1, 3, 5, 5, 31}},
+            {6, 1, {1, 3, 3, 9, 7, 49}},
+            {6, 13, {1, 1, 1, 15, 21, 21}},
+            {6, 16, {1, 3, 1, 13, 27, 49}},
+        }};
+
+        // directions[d][k] is the contribution of index bit k to dimension d
+        constexpr auto make_sobol_directions() noexcept {
+            std::array<std::array<u32, 32>, MAX_DIMENSIONS> v{};
+            for(int k = 0; k < 32; ++k){
+                v[0][k] = u32(1) << (31 - k); //the van der Corput sequence
+            }
+            for(std::size_t d = 1; d < MAX_DIMENSIONS; ++d){
+                const sobol_polynomial& p = JOE_KUO[d - 1];
+                const int s = static_cast<int>(p.s);
+                for(int k = 0; k < s; ++k){
+                    v[d][k] = p.m[k] << (31 - k);
+                }
+                for(int k = s; k < 32; ++k){
+                    u32 x = v[d][k - s] ^ (v[d][k - s] >> s);
+                    for(int j = 1; j < s; ++j){
+                        if((p.a >> (s - 1 - j)) & 1u){
+                            x ^= v[d][k - j];
+                        }
+                    }
+                    v[d][k] = x;
+                }
+            }
+            return v;
+        }
+
+        inline constexpr auto SOBOL_DIRECTIONS = make_sobol_directions();
+
+        inline constexpr std::array<u32, MAX_DIMENSIONS> PRIMES{2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+
+        inline constexpr double ONE_MINUS_EPSILON = 0x1.fffffffffffffp-1;
+
+        // [0, 1) as 64-bit fixed point. Exact for the 53 bits of a double.
+        constexpr u64 to_fixed(double x) noexcept {
+            return static_cast<u64>(x * 0x1.0p64);
+        }
+
+        // the digits of index in Base, mirrored around the radix point
+        template<u32 Base>
+        constexpr double radical_inverse(u64 index) noexcept {
+            constexpr double inverse = 1.0 / Base;
+            u64 reversed = 0;
+            double scale = 1.0;
+            while(index != 0){
+                const u64 next = index / Base; //a multiply, Base is a constant
+                reversed = reversed * Base + (index - next * Base);
+                scale *= inverse;
+                index = next;
+            }
+            const double x = static_cast<double>(reversed) * scale;
+            return x < ONE_MINUS_EPSILON ? x : ONE_MINUS_EPSILON;
+        }
+
+        // Owen scrambled radical inverse: every digit gets a random shift chosen by hashing the digits
+        // above it, for all the digits a double can hold, so the zeros past the index's last digit become
+        // random too.
+        template<u32 Base>
+        constexpr double scrambled_radical_inverse(u64 index, u64 seed) noexcept {
+            constexpr double inverse = 1.0 / Base;
+            double x = 0.0;
+            double scale = inverse;
+            u64 prefix = 0;
+            for(int depth = 0; scale > 0x1.0p-53; ++depth){
+                const u64 next = index / Base;
+                const u64 digit = index - next * Base;
+                const u64 node = seed::splitmix64(seed ^ seed::splitmix64(prefix ^ (static_cast<u64>(depth) << 56)));
+                x += static_cast<double>((digit + node % Base) % Base) * scale;
+                prefix = prefix * Base + digit + 1;
+                scale *= inverse;
+                index = next;
+            }
+            return x < ONE_MINUS_EPSILON ? x : ONE_MINUS_EPSILON;
+        }
+
+        // calls f(std::integral_constant<std::size_t, dim>), so the prime base is a compile-time constant
+        template<std::size_t Dims, typename F, std::size_t... D>
+        constexpr u64 dispatch(std::size_t dim, F&& f, std::index_sequence<D...>) noexcept {
+            u64 result = 0;
+            ((dim == D ? (result = f(std::integral_constant<std::size_t, D>{}), true) : false) || ...);
+            return result;
+        }
+
+        // the positive root of x^(d + 1) = x + 1: 2 for d = 0, the golden ratio for d = 1, the plastic number for d = 2
+        constexpr double generalized_golden_ratio(std::size_t d) noexcept {
+            double x = 2.0;
+            for(int i = 0; i < 64; ++i){ //Newton, converges in well under 64 steps
+                double power = 1.0; //x^d
+                for(std::size_t j = 0; j < d; ++j){
+                    power *= x;
+                }
+                x -= (power * x - x - 1.0) / ((static_cast<double>(d) + 1.0) * power - 1.0);
+            }
+            return x;
+        }
+    }
+
+    // Shared by the sequences: the coordinate walk, seeding and the engine plumbing. Sequence provides
+    // sample(index, dim) and seeds its scrambling from 64 bits.
+    template<typename Sequence, std::size_t Dims>
+        requires (Dims >= 1)
+    class sequence_interface : public engine_interface<Sequence, u64> {
+    public:
+        using engine_interface<Sequence, u64>::next; //next(bound)
+        static constexpr std::size_t DIMENSIONS = Dims;
+
+        // the next coordinate of the current point
+        constexpr u64 next() noexcept {
+            const u64 value = self().sample(index_, dim_);
+            if(++dim_ == Dims){
+                dim_ = 0;
+                ++index_;
+            }
+            return value;
+        }
+
+        // the rest of the current point, or a whole point if none of it was used, in [0, 1)
+        template<typename T = float>
+        constexpr std::array<T, Dims> next_point() noexcept {
+            std::array<T, Dims> p{};
+            for(std::size_t d = dim_; d < Dims; ++d){
+                p[d] = portable::uniform01<T>(self());
+            }
+            return p;
+        }
+
+        // O(1), moves count coordinates ahead
+        constexpr void discard(u64 count) noexcept {
+            count += dim_;
+            index_ += count / Dims;
+            dim_ = static_cast<std::size_t>(count % Dims);
+        }
+
+        // the point the next coordinate belongs to, and its dimension
+        constexpr u64 index() const noexcept { return index_; }
+        constexpr std::size_t dimension() const noexcept { return dim_; }
+
+        // jump to the first coordinate of point index
+        constexpr void seek(u64 index) noexcept {
+            index_ = index;
+            dim_ = 0;
+        }
+
+        constexpr bool operator==(const sequence_interface&) const noexcept = default;
+
+    private:
+        u64 index_ = 0;
+        std::size_t dim_ = 0;
+
+        constexpr Sequence& self() noexcept {
+            return static_cast<Sequence&>(*this);
+        }
+    };
+
+    template<std::size_t Dims>
+        requires (Dims <= detail::MAX_DIMENSIONS)
+    class Sobol : public sequence_interface<Sobol<Dims>, Dims> {
+    public:
+        // the plain Sobol sequence
+        constexpr Sobol() noexcept = default;
+
+        // Owen scrambled
+        constexpr explicit Sobol(u64 seed) noexcept : scrambled_(true) {
+            for(auto& s : seeds_){
+                seed = seed::splitmix64(seed);
+                s = static_cast<u32>(seed >> 32);
+            }
+        }
+
+        template<random_engine G>
+        constexpr explicit Sobol(G& rng) noexcept : Sobol(portable::bits64(rng)) {}
+
+        // coordinate dim of point index, the low 32 bits of index
+        constexpr u64 sample(u64 index, std::size_t dim) const noexcept {
+            assert(dim < Dims && "Sobol::sample: dimension out of range.");
+            const auto& v = detail::SOBOL_DIRECTIONS[dim];
+            u32 x = 0;
+            for(u32 i = static_cast<u32>(index), k = 0; i != 0; i >>= 1, ++k){
+                x ^= v[k] & (0u - (i & 1u));
+            }
+            if(!scrambled_){
+                return static_cast<u64>(x) << 32;
+            }
+            x = detail::owen_scramble(x, seeds_[dim]);
+            //the digits below the 32nd are random under Owen scrambling: hashed from the point's node
+            const u64 low = seed::splitmix64((static_cast<u64>(seeds_[dim]) << 32) | x);
+            return (static_cast<u64>(x) << 32) | (low >> 32);
+        }
+
+        constexpr bool operator==(const Sobol&) const noexcept = default;
+
+    private:
+        std::array<u32, Dims> seeds_{};
+        bool scrambled_ = false;
+    };
+
+    template<std::size_t Dims>
+        requires (Dims <= detail::MAX_DIMENSIONS)
+    class Halton : public sequence_interface<Halton<Dims>, Dims> {
+    public:
+        // the plain Halton sequence
+        constexpr Halton() noexcept = default;
+
+        // Owen scrambled
+        constexpr explicit Halton(u64 seed) noexcept : scrambled_(true) {
+            for(auto& s : seeds_){
+                s = seed = seed::splitmix64(seed);
+            }
+        }
+
+        template<random_engine G>
+        constexpr explicit Halton(G& rng) noexcept : Halton(portable::bits64(rng)) {}
+
+        // coordinate dim of point index: the radical inverse of index in the dim-th prime
+        constexpr u64 sample(u64 index, std::size_t dim) const noexcept {
+            assert(dim < Dims && "Halton::sample: dimension out of range.");
+            return detail::dispatch<Dims>(dim, [&](auto d){
+                constexpr u32 base = detail::PRIMES[decltype(d)::value];
+                if constexpr(base == 2){ //base 2 is a bit reversal, and scrambles like Sobol's first dimension
+                    if(!scrambled_){
+                        return static_cast<u64>(detail::reverse_bits(static_cast<u32>(index))) << 32;
+                    }
+                    const u32 x = detail::owen_scramble(detail::reverse_bits(static_cast<u32>(index)), static_cast<u32>(seeds_[0] >> 32));
+                    return (static_cast<u64>(x) << 32) | (seed::splitmix64(seeds_[0] ^ x) >> 32);
+                } else {
+                    return detail::to_fixed(scrambled_
+                        ? detail::scrambled_radical_inverse<base>(index, seeds_[decltype(d)::value])
+                        : detail::radical_inverse<base>(index));
+                }
+            }, std::make_index_sequence<Dims>{});
+        }
+
+        constexpr bool operator==(const Halton&) const noexcept = default;
+
+    private:
+        std::array<u64, Dims> seeds_{};
+        bool scrambled_ = false;
+    };
+
+    template<std::size_t Dims>
+    class Kronecker : public sequence_interface<Kronecker<Dims>, Dims> {
+    public:
+        // shifted by 1/2 in every dimension, as Roberts suggests
+        constexpr Kronecker() noexcept {
+            shifts_.fill(u64(1) << 63);
+        }
+
+        // a random shift per dimension
+        constexpr explicit Kronecker(u64 seed) noexcept {
+            for(auto& s : shifts_){
+                s = seed = seed::splitmix64(seed);
+            }
+        }
+
+        template<random_engine G>
+        constexpr explicit Kronecker(G& rng) noexcept : Kronecker(portable::bits64(rng)) {}
+
+        // coordinate dim of point index, exact in 64-bit fixed point: the sum wraps around at 1
+        constexpr u64 sample(u64 index, std::size_t dim) const noexcept {
+            assert(dim < Dims && "Kronecker::sample: dimension out of range.");
+            return shifts_[dim] + index * ALPHA[dim];
+        }
+
+        constexpr bool operator==(const Kronecker&) const noexcept = default;
+
+    private:
+        // alpha_j = 1 / phi^(j + 1) for the generalized golden ratio phi of Dims dimensions
+        static constexpr std::array<u64, Dims> ALPHA = []{
+            const double phi = detail::generalized_golden_ratio(Dims);
+            std::array<u64, Dims> alpha{};
+            double a = 1.0;
+            for(auto& v : alpha){
+                a /= phi;
+                v = detail::to_fixed(a);
+            }
+            return alpha;
+        }();
+
+        std::array<u64, Dims> shifts_{};
+    };
+
+    using R2 = Kronecker<2>;
+}
+
+/* Example usage:
+#include "low_discrepancy.hpp"
+#include "SmallFast_64.h"
+
+// any code written against the engine interface, one draw per coordinate
+template<typename G>
+float estimate_coverage(G& g, int samples) {
+    int hits = 0;
+    for(int i = 0; i < samples; ++i){
+        const float x = g.template unit_range<float>();
+        const float y = g.template unit_range<float>();
+        hits += (x * x + y * y < 1.0f);
+    }
+    return 4.0f * static_cast<float>(hits) / static_cast<float>(samples);     //pi
+}
+
+int main() {
+    SmallFast64 rng(42);
+    float white = estimate_coverage(rng, 4096);                  //error ~ 1/sqrt(n)
+
+    low_discrepancy::Sobol<2> sobol(rng);                       //Owen scrambled, seeded from rng
+    float stratified = estimate_coverage(sobol, 4096);          //error ~ 1/n, up to log factors
+
+    // 5D samples for a path tracer bounce: lens u, v, light u, v, and the BSDF lobe
+    low_discrepancy::Halton<5> halton(rng);
+    auto p = halton.next_point<float>();
+
+    // foliage placement on a terrain tile, any number of points
+    low_discrepancy::R2 r2(rng);
+    for(int i = 0; i < 1000; ++i){
+        float x = r2.between(0.0f, 512.0f);
+        float z = r2.between(0.0f, 512.0f);
+        (void)x; (void)z;
+    }
+    return static_cast<int>(white + stratified + p[4]);
+}
+*/
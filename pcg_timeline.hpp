@@ -0,0 +1,187 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "PCG32.hpp"
+// Random access into a PCG32 stream, for rollback netcode and replays.
+//
+// PCG32::advance / backstep are O(log n): fine once, costly dozens of times per frame for thousands
+// of entities. pcg_timeline maps a logical draw index (0 = the first value the origin generator
+// returns) to the generator state in O(1):
+//
+// The LCG step is affine, so n steps from state s give  A_n * s + inc * G_n  (mod 2^64), where
+// A_n = MULT^n and G_n = 1 + MULT + ... + MULT^(n-1) are the same for every stream. Split n into
+// keyframe * INTERVAL + offset: the timeline keeps the state at every keyframe, and one shared
+// compile-time table holds A and G for every offset. A seek is then two multiplies and an add.
+// Keyframes are created on demand (one affine step each), so the cost is O(1) amortized, and old
+// ones can be dropped with forget_before() once they fall out of the rollback window.
+//
+// index_of(rng) goes the other way - the draw index of any generator on the same stream - in at most
+// 64 steps (the distance algorithm from O'Neill's pcg-cpp), so you can record positions lazily.
+class pcg_timeline {
+public:
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+    static constexpr u64 INTERVAL = 1024; //draws between keyframes
+
+    explicit pcg_timeline(const PCG32& origin) noexcept {
+        const auto [state, inc] = origin.get_state();
+        inc_ = inc | 1u;
+        origin_ = state;
+        keys_.push_back(state);
+    }
+
+    // a generator whose next() returns draw number index
+    PCG32 seek(u64 index) {
+        return PCG32::from_state(state_at(index), inc_);
+    }
+
+    // the raw state before draw number index
+    u64 state_at(u64 index) {
+        const u64 key = index / INTERVAL;
+        const auto offset = static_cast<std::size_t>(index % INTERVAL);
+        const auto& t = jumps();
+        return t.mult[offset] * keyframe(key) + inc_ * t.plus[offset];
+    }
+
+    // draw index of rng, which must be on this timeline's stream
+    u64 index_of(const PCG32& rng) const noexcept {
+        assert(rng.get_state().second == inc_ && "pcg_timeline::index_of: generator is on another stream.");
+        return distance(origin_, rng.get_state().first);
+    }
+
+    // number of draws rng made since draw number index
+    u64 draws_since(u64 index, const PCG32& rng) {
+        assert(rng.get_state().second == inc_ && "pcg_timeline::draws_since: generator is on another stream.");
+        return distance(state_at(index), rng.get_state().first);
+    }
+
+    // the values of draws [first, last), written to out which must hold last - first values
+    void generate(u64 first, u64 last, std::span<u32> out) {
+        assert(first <= last && out.size() >= last - first);
+        const auto& t = jumps();
+        std::size_t written = 0;
+        while(first < last){
+            //every value in a keyframe block is independent of the others, which pipelines (and
+            // vectorizes) far better than the serial next() chain
+            const u64 base = keyframe(first / INTERVAL);
+            const u64 plus = inc_;
+            const auto begin = static_cast<std::size_t>(first % INTERVAL);
+            const auto end = static_cast<std::size_t>(std::min<u64>(INTERVAL, begin + (last - first)));
+            for(std::size_t offset = begin; offset < end; ++offset){
+                out[written++] = PCG32::output(t.mult[offset] * base + plus * t.plus[offset]);
+            }
+            first += end - begin;
+        }
+    }
+
+    std::vector<u32> generate(u64 first, u64 last) {
+        std::vector<u32> out(static_cast<std::size_t>(last - first));
+        generate(first, last, out);
+        return out;
+    }
+
+    // precomputes keyframes up to index, eg. at load time
+    void reserve(u64 index) {
+        keyframe(index / INTERVAL);
+    }
+
+    // drops keyframes older than index's, for bounded rollback windows. Seeks before it still work,
+    // through an O(log n) jump from the origin.
+    void forget_before(u64 index) {
+        const u64 key = index / INTERVAL;
+        if(key <= first_key_){
+            return;
+        }
+        keyframe(key);
+        keys_.erase(keys_.begin(), keys_.begin() + static_cast<std::ptrdiff_t>(key - first_key_));
+        first_key_ = key;
+    }
+
+    u64 stream() const noexcept { return inc_; }
+
+private:
+    struct jump_table {
+        std::array<u64, INTERVAL + 1> mult; //A_n = MULT^n
+        std::array<u64, INTERVAL + 1> plus; //G_n = MULT^0 + ... + MULT^(n-1), multiplied by inc at use
+    };
+
+    static const jump_table& jumps() noexcept {
+        static constexpr jump_table table = []{
+            jump_table t{};
+            t.mult[0] = 1;
+            t.plus[0] = 0;
+            for(std::size_t n = 1; n <= INTERVAL; ++n){
+                t.mult[n] = t.mult[n - 1] * PCG32::PCG32_MULT;
+                t.plus[n] = t.plus[n - 1] * PCG32::PCG32_MULT + 1;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    std::vector<u64> keys_; //keys_[k] is the state at draw (first_key_ + k) * INTERVAL
+    u64 first_key_ = 0;
+    u64 inc_ = 1;
+    u64 origin_ = 0;        //state before draw 0, kept for index_of after forget_before
+
+    u64 keyframe(u64 key) {
+        if(key < first_key_){ //forgotten: jump from the origin instead
+            PCG32 rng = PCG32::from_state(origin_, inc_);
+            rng.advance(key * INTERVAL);
+            return rng.get_state().first;
+        }
+        const auto& t = jumps();
+        while(first_key_ + keys_.size() <= key){
+            keys_.push_back(t.mult[INTERVAL] * keys_.back() + inc_ * t.plus[INTERVAL]);
+        }
+        return keys_[static_cast<std::size_t>(key - first_key_)];
+    }
+
+    // number of steps from state 'from' to state 'to' on this stream, at most 64 iterations. A state
+    // on another stream never matches: the result is then meaningless, but the loop still ends.
+    u64 distance(u64 from, u64 to) const noexcept {
+        u64 mult = PCG32::PCG32_MULT;
+        u64 plus = inc_;
+        u64 bit = 1;
+        u64 steps = 0;
+        for(int i = 0; i < 64 && from != to; ++i){
+            if((from & bit) != (to & bit)){
+                from = from * mult + plus;
+                steps |= bit;
+            }
+            bit <<= 1;
+            plus = (mult + 1) * plus;
+            mult *= mult;
+        }
+        return steps;
+    }
+};
+
+/* Example usage:
+#include "pcg_timeline.hpp"
+
+int main() {
+    PCG32 rng(42, 7);
+    pcg_timeline timeline(rng);
+
+    std::vector<std::uint64_t> frame_start;            //draw index at the start of each frame
+    for(int frame = 0; frame < 600; ++frame){
+        frame_start.push_back(timeline.index_of(rng));
+        rng.between(1, 6);                             //simulate, any number of draws per frame
+        rng.normalized();
+    }
+
+    // rollback to frame 590 and resimulate: no replay from the session start
+    rng = timeline.seek(frame_start[590]);
+
+    // the exact values frame 590 drew, in bulk
+    auto values = timeline.generate(frame_start[590], frame_start[591]);
+
+    timeline.forget_before(frame_start[500]);          //keep a bounded window
+    return static_cast<int>(timeline.draws_since(frame_start[590], rng) + values.size());
+}
+*/
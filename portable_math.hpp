@@ -0,0 +1,371 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <type_traits>
+// Deterministic, constexpr math and bit-to-float conversions for the portable samplers.
+//
+// The standard library makes no promise that std::exp, std::log, std::pow and friends return the
+// same bits on libstdc++, libc++ and MSVC - and they don't. Anything built on them (including every
+// std::*_distribution) can give different sequences on different platforms, which breaks lockstep
+// simulations, replays and client/server agreement.
+//
+// Everything here is written in terms of the basic IEEE-754 operations (+ - * /), which ARE
+// correctly rounded everywhere, and is therefore bit-identical across compilers as long as each
+// operation is rounded on its own: no floating point contraction of a * b + c into an FMA. That is
+// NOT the default. GCC contracts under -std=c++XX whenever the target has FMA (-march=haswell and
+// later, ARM64), and Clang 14+ defaults to -ffp-contract=on, so the same seed gives different
+// samples on different machines. Clang and MSVC are handled here: PORTABLE_FP_BEGIN/END turn
+// contraction off for the code between them (#pragma clang fp contract(off), and /fp:precise with
+// fp_contract(off) on MSVC), and every portable header is wrapped in them. GCC has no per-file
+// switch (#pragma GCC optimize("fp-contract=off") doesn't stop it either) and no macro for the
+// flag, so on FMA targets it is a build error unless you build with -ffp-contract=off and define
+// PORTABLE_FP_CONTRACT_OFF to say so. -std=c++20 instead of gnu++20 is not enough: g++ 12 contracts
+// in both. Never use -ffast-math.
+// sqrt is the one exception: IEEE-754 requires it to be correctly rounded, so std::sqrt is used at
+// runtime and a Newton iteration is only used during constant evaluation.
+//
+// Accuracy is within a couple of ulp, which is plenty for sampling. These are not replacements
+// for a real libm.
+#if defined(__clang__)
+#define PORTABLE_FP_BEGIN _Pragma("float_control(push)") _Pragma("clang fp contract(off)")
+#define PORTABLE_FP_END _Pragma("float_control(pop)")
+#elif defined(_MSC_VER)
+// float_control doesn't save fp_contract, it stays off after END (the default since VS 2022)
+#define PORTABLE_FP_BEGIN __pragma(float_control(precise, on, push)) __pragma(fp_contract(off))
+#define PORTABLE_FP_END __pragma(float_control(pop))
+#else //GCC: -ffp-contract=off, see above
+#if defined(__GNUC__) && defined(__FP_FAST_FMA) && !defined(PORTABLE_FP_CONTRACT_OFF)
+#error "portable_math.hpp: GCC fuses a * b + c into FMAs on this target. Build with -ffp-contract=off and -DPORTABLE_FP_CONTRACT_OFF"
+#endif
+#define PORTABLE_FP_BEGIN
+#define PORTABLE_FP_END
+#endif
+
+PORTABLE_FP_BEGIN
+namespace portable {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    inline constexpr double LN2_HI = 6.93147180369123816490e-01; //fdlibm split of ln(2), so that k * LN2_HI is exact
+    inline constexpr double LN2_LO = 1.90821492927058770002e-10;
+    inline constexpr double INV_LN2 = 1.44269504088896338700e+00;
+    inline constexpr double HALF_LN_2PI = 0.91893853320467274178;
+
+    constexpr double abs(double x) noexcept {
+        return x < 0.0 ? -x : x;
+    }
+
+    // floor for values that fit in an int64. Good enough for every sampler in this repo.
+    constexpr double floor(double x) noexcept {
+        const auto t = static_cast<double>(static_cast<std::int64_t>(x));
+        return (x < t) ? t - 1.0 : t;
+    }
+
+    // 2^k, for k in [-1074, 1023]
+    constexpr double pow2(int k) noexcept {
+        if(k < -1022){ //subnormal result, scale in two steps
+            return pow2(k + 600) * pow2(-600);
+        }
+        return std::bit_cast<double>(static_cast<u64>(k + 1023) << 52);
+    }
+
+    constexpr double exp(double x) noexcept {
+        if(x != x){ return x; }
+        if(x > 709.782712893384){ return std::numeric_limits<double>::infinity(); }
+        if(x < -745.1332191019412){ return 0.0; }
+        //x = k*ln(2) + r, |r| <= ln(2)/2
+        const auto k = static_cast<int>(x * INV_LN2 + (x < 0.0 ? -0.5 : 0.5));
+        const double r = (x - k * LN2_HI) - k * LN2_LO;
+        //Taylor series to degree 15, Horner form. |r|^16/16! < 2^-70
+        constexpr auto inverse_factorial = []{
+            std::array<double, 16> c{};
+            double f = 1.0;
+            for(int n = 0; n < 16; ++n){
+                f *= (n == 0) ? 1.0 : n;
+                c[n] = 1.0 / f;
+            }
+            return c;
+        }();
+        double p = inverse_factorial[15];
+        for(int n = 14; n >= 0; --n){
+            p = p * r + inverse_factorial[n];
+        }
+        if(k > 1023){ //x just below the overflow threshold: 2^1024 isn't a double, scale in two steps
+            return p * pow2(k - 1) * 2.0;
+        }
+        return p * pow2(k);
+    }
+
+    constexpr double log(double x) noexcept {
+        if(x != x || x < 0.0){ return std::numeric_limits<double>::quiet_NaN(); }
+        if(x == 0.0){ return -std::numeric_limits<double>::infinity(); }
+        if(x == std::numeric_limits<double>::infinity()){ return x; }
+        int e = 0;
+        if(x < std::numeric_limits<double>::min()){ //subnormal, normalize first
+            x *= pow2(54);
+            e = -54;
+        }
+        //x = m * 2^e, m in [sqrt(2)/2, sqrt(2))
+        const auto bits = std::bit_cast<u64>(x);
+        e += static_cast<int>((bits >> 52) & 0x7FF) - 1023;
+        double m = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+        if(m > 1.4142135623730951){
+            m *= 0.5;
+            ++e;
+        }
+        //log(m) = 2*atanh(s), s = (m-1)/(m+1), |s| < 0.1716
+        const double f = m - 1.0;
+        const double s = f / (2.0 + f);
+        const double s2 = s * s;
+        constexpr double inverse_odd[] = {
+            1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17, 1.0 / 19, 1.0 / 21, 1.0 / 23
+        };
+        double series = 0.0;
+        for(int n = 10; n >= 0; --n){
+            series = (series + inverse_odd[n]) * s2;
+        }
+        const double log_m = 2.0 * s + 2.0 * s * series;
+        return e * LN2_HI + (log_m + e * LN2_LO);
+    }
+
+    // log(1 + x), accurate for small x
+    constexpr double log1p(double x) noexcept {
+        const double u = 1.0 + x;
+        if(u == 1.0){ return x; }
+        return log(u) * x / (u - 1.0);
+    }
+
+    constexpr double sqrt(double x) noexcept {
+        if(!std::is_constant_evaluated()){
+            return std::sqrt(x); //correctly rounded by IEEE-754 requirement, identical everywhere
+        }
+        if(x != x || x < 0.0){ return std::numeric_limits<double>::quiet_NaN(); }
+        if(x == 0.0 || x == std::numeric_limits<double>::infinity()){ return x; }
+        double y = std::bit_cast<double>((std::bit_cast<u64>(x) >> 1) + (u64(1023) << 51));
+        for(int i = 0; i < 8; ++i){
+            y = 0.5 * (y + x / y);
+        }
+        return y;
+    }
+
+    // base^e, for base > 0
+    constexpr double pow(double base, double e) noexcept {
+        return exp(e * log(base));
+    }
+
+    // Stirling series correction term: fc(k) = log(k!) - [(k + 0.5)log(k + 1) - (k + 1) + 0.5log(2pi)]
+    // As used by Hormann's BTRD and PTRS. Tabulated for small k.
+    constexpr double stirling_correction(std::int64_t k) noexcept {
+        constexpr double table[] = {
+            0.08106146679532726, 0.04134069595540929, 0.02767792568499834, 0.02079067210376509,
+            0.01664469118982119, 0.01387612882307075, 0.01189670994589177, 0.01041126526197209,
+            0.009255462182712733, 0.008330563433362871
+        };
+        if(k < 10){
+            return table[k];
+        }
+        const double ikp1 = 1.0 / static_cast<double>(k + 1);
+        const double ikp1_2 = ikp1 * ikp1;
+        return (1.0 / 12 - (1.0 / 360 - (1.0 / 1260) * ikp1_2) * ikp1_2) * ikp1;
+    }
+
+    // log(k!)
+    constexpr double log_factorial(std::int64_t k) noexcept {
+        const auto kp1 = static_cast<double>(k + 1);
+        return (static_cast<double>(k) + 0.5) * log(kp1) - kp1 + HALF_LN_2PI + stirling_correction(k);
+    }
+
+    // full 64x64 -> 128-bit product, as {high, low}
+    struct u128_parts {
+        u64 hi;
+        u64 lo;
+    };
+    constexpr u128_parts umul128(u64 a, u64 b) noexcept {
+#ifdef __SIZEOF_INT128__
+        const auto product = static_cast<unsigned __int128>(a) * b;
+        return {static_cast<u64>(product >> 64), static_cast<u64>(product)};
+#else
+        const u64 a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+        const u64 b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+        const u64 lo_lo = a_lo * b_lo;
+        const u64 hi_lo = a_hi * b_lo;
+        const u64 lo_hi = a_lo * b_hi;
+        const u64 hi_hi = a_hi * b_hi;
+        const u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+        return {hi_hi + (hi_lo >> 32) + (cross >> 32), (cross << 32) | (lo_lo & 0xFFFFFFFF)};
+#endif
+    }
+
+    // Raw bits and uniform floats from any full-range 32- or 64-bit engine. The conversions are fixed
+    // so every engine always consumes the same number of draws for the same call.
+    template<typename G>
+    concept full_range_engine = std::uniform_random_bit_generator<G>
+        && G::min() == 0
+        && (G::max() == std::numeric_limits<u32>::max() || G::max() == std::numeric_limits<u64>::max());
+
+    template<full_range_engine G>
+    constexpr u64 bits64(G& g) noexcept(noexcept(g())) {
+        if constexpr(G::max() == std::numeric_limits<u64>::max()){
+            return static_cast<u64>(g());
+        } else {
+            const auto hi = static_cast<u64>(g());
+            return (hi << 32) | static_cast<u64>(g());
+        }
+    }
+
+    template<full_range_engine G>
+    constexpr u32 bits32(G& g) noexcept(noexcept(g())) {
+        if constexpr(G::max() == std::numeric_limits<u64>::max()){
+            return static_cast<u32>(static_cast<u64>(g()) >> 32); //the high bits are the better ones for most engines
+        } else {
+            return static_cast<u32>(g());
+        }
+    }
+
+    // [0, 1), by multiplication: 24 bits of randomness for float, 53 bits for double.
+    template<std::floating_point T = double, full_range_engine G>
+    constexpr T uniform01(G& g) noexcept(noexcept(g())) {
+        if constexpr(std::is_same_v<T, float>){
+            return static_cast<float>(bits32(g) >> 8) * 0x1.0p-24f;
+        } else {
+            return static_cast<T>(static_cast<double>(bits64(g) >> 11) * 0x1.0p-53);
+        }
+    }
+
+    // (0, 1), never returns 0 so it is safe to take the log
+    template<full_range_engine G>
+    constexpr double uniform01_open(G& g) noexcept(noexcept(g())) {
+        return (static_cast<double>(bits64(g) >> 11) + 0.5) * 0x1.0p-53;
+    }
+
+    // Lemire's nearly divisionless bounded draw, [0, bound), bound > 0.
+    // Bounds up to 2^32 use a 32-bit draw (bits32) and a 64-bit multiply, larger bounds a 64-bit draw
+    // (bits64) and a 128-bit multiply. https://arxiv.org/abs/1805.10941
+    template<full_range_engine G>
+    constexpr u64 bounded(G& g, u64 bound) noexcept {
+        if(bound <= (u64(1) << 32)){
+            u64 m = u64(bits32(g)) * bound;
+            auto low = static_cast<u32>(m);
+            if(low < bound){
+                const auto threshold = static_cast<u32>((u64(1) << 32) % bound);
+                while(low < threshold){
+                    m = u64(bits32(g)) * bound;
+                    low = static_cast<u32>(m);
+                }
+            }
+            return m >> 32;
+        }
+        auto m = umul128(bits64(g), bound);
+        if(m.lo < bound){
+            const u64 threshold = (0 - bound) % bound;
+            while(m.lo < threshold){
+                m = umul128(bits64(g), bound);
+            }
+        }
+        return m.hi;
+    }
+
+    // Batched bounded draws, Brackett-Rozinsky & Lemire, "Batched Ranged Random Integer Generation" (2024).
+    // x * b1 puts a value in [0, b1) in the high word and leaves a fraction in the low word, which times
+    // b2 gives a value in [0, b2), and so on: one draw for several bounded values. They are jointly
+    // uniform if the final low word is at least 2^64 mod (b1 * b2 * ...), otherwise the whole group is
+    // drawn again. Each group's product is kept below 2^56, so a group is redrawn less than 1 time in 256.
+    inline constexpr u64 BATCH_PRODUCT_LIMIT = u64(1) << 56;
+
+    // out[i] in [0, bounds[i]), each bound > 0. As many values per 64-bit draw as the bounds allow:
+    // 21 six-sided dice, or 14 d20s.
+    template<full_range_engine G>
+    constexpr void bounded_batch(G& g, std::span<const std::uint16_t> bounds, std::span<std::uint16_t> out) noexcept {
+        assert(bounds.size() == out.size() && "bounded_batch: bounds and out differ in size.");
+        std::size_t first = 0;
+        while(first < bounds.size()){
+            //the group grows while the product stays in bounds, the product and the values are two
+            //independent multiply chains that overlap
+            u64 x = bits64(g);
+            u64 product = 1;
+            std::size_t last = first;
+            for(; last < bounds.size(); ++last){
+                assert(bounds[last] > 0 && "bounded_batch: bounds must be positive.");
+                const auto p = umul128(product, bounds[last]);
+                if(p.hi != 0 || p.lo > BATCH_PRODUCT_LIMIT){
+                    break;
+                }
+                product = p.lo;
+                const auto m = umul128(x, bounds[last]);
+                out[last] = static_cast<std::uint16_t>(m.hi);
+                x = m.lo;
+            }
+            if(x >= product || x >= (0 - product) % product){ //the division only when x < product
+                first = last;
+            } //else the same group again with a new draw
+        }
+    }
+
+    // out[i] in [0, bound), bound > 0. The same technique on 32-bit words with products below 2^24,
+    // laid out so the multiplies run over 256 words at once in a loop the compiler vectorizes: the
+    // words for a block are drawn first, then every word steps through its chain together, and the
+    // rare rejected words are redrawn one by one. Not the same values as the span-of-bounds overload.
+    // The 32x16-bit multiplies are cheap with AVX2 (-mavx2 or -march), baseline SSE2 emulates them.
+    template<full_range_engine G>
+    constexpr void bounded_batch(G& g, std::uint16_t bound, std::span<std::uint16_t> out) noexcept {
+        assert(bound > 0 && "bounded_batch: bound must be positive.");
+        constexpr std::size_t WORDS = 256;
+        constexpr std::size_t MAX_PER_WORD = 24; //bound 2
+        std::size_t per_word = 1;
+        u32 product = bound;
+        while(per_word < MAX_PER_WORD && u64(product) * bound <= (u64(1) << 24)){
+            product *= bound;
+            ++per_word;
+        }
+        const u32 threshold = (0u - product) % product; //2^32 mod product
+        std::array<u32, WORDS> words{};
+        std::array<std::array<std::uint16_t, WORDS>, MAX_PER_WORD> values{};
+        for(std::size_t first = 0; first < out.size(); first += WORDS * per_word){
+            const std::size_t count = (out.size() - first < WORDS * per_word) ? out.size() - first : WORDS * per_word;
+            const std::size_t used = (count + per_word - 1) / per_word;
+            for(std::size_t w = 0; w < used; w += 2){
+                const u64 bits = bits64(g);
+                words[w] = static_cast<u32>(bits >> 32);
+                words[w + 1] = static_cast<u32>(bits); //WORDS is even, so w + 1 is in the block
+            }
+            for(std::size_t k = 0; k < per_word; ++k){
+                for(std::size_t w = 0; w < WORDS; ++w){ //the whole block, a fixed trip count needs no scalar tail
+                    const u64 m = u64(words[w]) * bound;
+                    values[k][w] = static_cast<std::uint16_t>(m >> 32);
+                    words[w] = static_cast<u32>(m);
+                }
+            }
+            u32 rejected = 0; //a vectorized check first, the scan below is rarely needed
+            for(std::size_t w = 0; w < WORDS; ++w){
+                rejected |= static_cast<u32>(words[w] < threshold);
+            }
+            for(std::size_t w = 0; rejected != 0 && w < used; ++w){
+                while(words[w] < threshold){
+                    u32 x = bits32(g);
+                    for(std::size_t k = 0; k < per_word; ++k){
+                        const u64 m = u64(x) * bound;
+                        values[k][w] = static_cast<std::uint16_t>(m >> 32);
+                        x = static_cast<u32>(m);
+                    }
+                    words[w] = x;
+                }
+            }
+            //row by row: value k of every word, then value k + 1, so each row is one contiguous copy
+            for(std::size_t k = 0, i = first; k < per_word && i < first + count; ++k, i += used){
+                const std::size_t n = (first + count - i < used) ? first + count - i : used;
+                for(std::size_t w = 0; w < n; ++w){
+                    out[i + w] = values[k][w];
+                }
+            }
+        }
+    }
+}
+PORTABLE_FP_END
@@ -0,0 +1,582 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "seed.hpp"
+// Statistical quality harness for the PRNGs in this repo. A "BigCrush-lite" you can run locally,
+// with no external tools. Runs a battery of classic empirical tests over the raw output stream
+// AND over the convenience interface (bounded draws, next_2/next_4, float conversion, between)
+// since that is where most of the bugs hide.
+//
+// The battery:
+// - chi-square on bounded draws, next(bound)
+// - chi-square on the joint distribution of next_2 / next_4 (when the engine has them)
+// - float conversion: histogram of normalized() plus a hard check of the [0, 1) contract
+// - birthday spacings (Marsaglia) on the high and (for 64-bit engines) the low 32 bits of the output
+// - gap test and runs-up test (Knuth, TAOCP vol 2) on the raw output as doubles
+// - linear complexity (NIST SP 800-22, Berlekamp-Massey) of the lowest output bit
+// - sliding-window uniformity of between(min, max), over windows at various offsets and widths
+//
+// The output is streamed in chunks on all available cores. Each worker owns one engine, seeded
+// from the run seed via splitmix64, and keeps pulling chunks until the byte budget is spent.
+// Statistics are accumulated per worker and merged at the end, so memory use stays flat no matter
+// how many gigabytes you push through.
+//
+// A p-value outside [1e-6, 1 - 1e-6] is a FAIL, outside [1e-3, 1 - 1e-3] it is flagged as
+// "unusual" (expect about one of those per few hundred results from a perfect generator).
+namespace quality {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    struct options {
+        u64 total_bytes = u64(4) << 30;         // raw output to push through the battery
+        u64 chunk_bytes = u64(64) << 20;        // work unit handed to a worker
+        unsigned threads = 0;                   // 0 = std::thread::hardware_concurrency()
+        u64 seed = 0x5EED5EED5EED5EEDull;
+        std::size_t complexity_block = 1000;    // bits per Berlekamp-Massey block (NIST: 500-5000)
+    };
+
+    struct test_result {
+        std::string name;
+        double statistic = 0.0;
+        double p_value = 0.5;
+        std::string note{};
+
+        constexpr bool failed() const noexcept {
+            return p_value < 1e-6 || p_value > 1.0 - 1e-6;
+        }
+        constexpr bool unusual() const noexcept {
+            return p_value < 1e-3 || p_value > 1.0 - 1e-3;
+        }
+
+        void write(std::ostream& out) const {
+            const auto verdict = failed() ? "FAIL" : (unusual() ? "unusual" : "pass");
+            out << std::left << std::setw(34) << name << std::right
+                << std::setw(16) << std::setprecision(6) << statistic
+                << "  p = " << std::setw(12) << std::setprecision(6) << p_value
+                << "  " << verdict;
+            if(!note.empty()){
+                out << "  (" << note << ")";
+            }
+            out << '\n';
+        }
+    };
+
+    struct report {
+        std::string engine;
+        u64 bytes = 0;
+        std::vector<test_result> results;
+
+        bool passed() const noexcept {
+            return std::none_of(results.begin(), results.end(), [](const auto& r){ return r.failed(); });
+        }
+
+        void write(std::ostream& out) const {
+            out << "== " << engine << " - " << (bytes >> 20) << " MiB ==\n";
+            for(const auto& r : results){
+                r.write(out);
+            }
+            out << (passed() ? "PASSED\n" : "FAILED\n");
+        }
+    };
+
+    namespace stats {
+        // regularized upper incomplete gamma function Q(a, x). Numerical Recipes, 3rd ed, 6.2
+        inline double gamma_q(double a, double x) noexcept {
+            if(x <= 0.0){ return 1.0; }
+            const double gln = std::lgamma(a);
+            if(x < a + 1.0){ //series representation of P(a, x)
+                double ap = a;
+                double del = 1.0 / a;
+                double sum = del;
+                for(int i = 0; i < 100000; ++i){
+                    ap += 1.0;
+                    del *= x / ap;
+                    sum += del;
+                    if(std::fabs(del) < std::fabs(sum) * 1e-15){ break; }
+                }
+                return 1.0 - sum * std::exp(-x + a * std::log(x) - gln);
+            }
+            //continued fraction representation of Q(a, x), modified Lentz
+            constexpr double tiny = std::numeric_limits<double>::min() / std::numeric_limits<double>::epsilon();
+            double b = x + 1.0 - a;
+            double c = 1.0 / tiny;
+            double d = 1.0 / b;
+            double h = d;
+            for(int i = 1; i < 100000; ++i){
+                const double an = -i * (i - a);
+                b += 2.0;
+                d = an * d + b;
+                if(std::fabs(d) < tiny){ d = tiny; }
+                c = b + an / c;
+                if(std::fabs(c) < tiny){ c = tiny; }
+                d = 1.0 / d;
+                const double del = d * c;
+                h *= del;
+                if(std::fabs(del - 1.0) < 1e-15){ break; }
+            }
+            return std::exp(-x + a * std::log(x) - gln) * h;
+        }
+
+        inline double chi_square_p(double chi2, double dof) noexcept {
+            return gamma_q(dof * 0.5, chi2 * 0.5);
+        }
+
+        // sums (observed - expected)^2 / expected over all bins. Returns {chi2, degrees of freedom}
+        template<typename Counts, typename Probabilities>
+        std::pair<double, double> chi_square(const Counts& observed, const Probabilities& probability) {
+            double total = 0.0;
+            for(auto o : observed){ total += static_cast<double>(o); }
+            double chi2 = 0.0;
+            std::size_t bins = 0;
+            for(std::size_t i = 0; i < observed.size(); ++i){
+                const double expected = total * probability[i];
+                if(expected <= 0.0){ continue; }
+                const double diff = static_cast<double>(observed[i]) - expected;
+                chi2 += diff * diff / expected;
+                ++bins;
+            }
+            return {chi2, static_cast<double>(bins > 1 ? bins - 1 : 1)};
+        }
+
+        inline test_result chi_square_test(std::string name, const std::vector<u64>& observed, const std::vector<double>& probability) {
+            const auto [chi2, dof] = chi_square(observed, probability);
+            return {std::move(name), chi2, chi_square_p(chi2, dof)};
+        }
+
+        inline test_result uniform_test(std::string name, const std::vector<u64>& observed) {
+            return chi_square_test(std::move(name), observed, std::vector<double>(observed.size(), 1.0 / observed.size()));
+        }
+    }
+
+    namespace detail {
+        // Adapters over the slightly different interfaces of the engines in this repo.
+        template<typename E>
+        using result_t = decltype(std::declval<E&>().next());
+
+        template<typename E>
+        constexpr int bits_v = std::numeric_limits<result_t<E>>::digits;
+
+        template<typename E>
+        u64 bounded(E& e, u32 bound) {
+            if constexpr(requires { e.next(bound); }){
+                return static_cast<u64>(e.next(bound));
+            } else {
+                return static_cast<u64>(e.inRange(static_cast<std::uint_fast64_t>(bound)));
+            }
+        }
+
+        template<typename E>
+        float normalized(E& e) {
+            if constexpr(requires { e.template normalized<float>(); }){
+                return e.template normalized<float>();
+            } else {
+                return static_cast<float>(e.normalized());
+            }
+        }
+
+        template<typename E>
+        int between(E& e, int min, int max) {
+            if constexpr(requires { e.between(min, max); }){
+                return e.between(min, max);
+            } else {
+                return e.inRange(min, max);
+            }
+        }
+
+        // raw output word as a double in [0, 1)
+        template<typename E>
+        double to_unit(result_t<E> x) noexcept {
+            if constexpr(bits_v<E> == 64){
+                return static_cast<double>(x >> 11) * 0x1.0p-53;
+            } else {
+                return static_cast<double>(x) * 0x1.0p-32;
+            }
+        }
+
+        // 32 bits of a raw output word, from the top or the bottom
+        template<typename E>
+        u32 bits32(result_t<E> x, bool high) noexcept {
+            return static_cast<u32>(high ? (x >> (bits_v<E> - 32)) : x);
+        }
+
+        // linear complexity of a bit sequence over GF(2)
+        inline std::size_t berlekamp_massey(const std::vector<std::uint8_t>& s) {
+            const std::size_t n = s.size();
+            std::vector<std::uint8_t> c(n + 1, 0), b(n + 1, 0), t;
+            c[0] = b[0] = 1;
+            std::size_t L = 0;
+            std::ptrdiff_t m = -1;
+            for(std::size_t i = 0; i < n; ++i){
+                std::uint8_t d = s[i];
+                for(std::size_t j = 1; j <= L; ++j){
+                    d ^= c[j] & s[i - j];
+                }
+                if(d == 0){ continue; }
+                t = c;
+                const std::size_t shift = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(i) - m);
+                for(std::size_t j = 0; j + shift <= n; ++j){
+                    c[j + shift] ^= b[j];
+                }
+                if(2 * L <= i){
+                    L = i + 1 - L;
+                    m = static_cast<std::ptrdiff_t>(i);
+                    b = t;
+                }
+            }
+            return L;
+        }
+    }
+
+    // Per-worker accumulator for the whole battery. Merged after all chunks have been consumed.
+    template<typename Engine>
+    class battery {
+        using result_type = detail::result_t<Engine>;
+        static constexpr int BITS = detail::bits_v<Engine>;
+
+        static constexpr u32 BOUND = 1000;
+        static constexpr u32 PAIR_BOUND = 40;
+        static constexpr u32 QUAD_BOUND = 6;
+        static constexpr std::size_t FLOAT_BINS = 1024;
+        static constexpr std::size_t BIRTHDAYS = 4096;   //m, in a year of n = 2^32 days: lambda = m^3 / 4n = 4
+        static constexpr double BIRTHDAY_LAMBDA = 4.0;
+        static constexpr std::size_t POISSON_BINS = 12;
+        static constexpr double GAP_LO = 0.0, GAP_HI = 0.25;
+        static constexpr std::size_t GAP_BINS = 24;
+        static constexpr std::size_t RUN_BINS = 6;
+        static constexpr std::size_t COMPLEXITY_BLOCKS_PER_CHUNK = 32;
+        static constexpr std::array<std::pair<int, int>, 6> WINDOWS{{
+            {0, 5}, {1, 6}, {-3, 3}, {0, 99}, {-50, 49}, {1000, 1255}
+        }};
+
+        std::vector<u64> bounded = std::vector<u64>(BOUND);
+        std::vector<u64> pairs = std::vector<u64>(PAIR_BOUND * PAIR_BOUND);
+        std::vector<u64> quads = std::vector<u64>(QUAD_BOUND * QUAD_BOUND * QUAD_BOUND * QUAD_BOUND);
+        std::vector<u64> floats = std::vector<u64>(FLOAT_BINS);
+        u64 floats_out_of_range = 0;
+        std::array<std::vector<u64>, 2> birthdays{std::vector<u64>(POISSON_BINS), std::vector<u64>(POISSON_BINS)};
+        std::vector<u64> gaps = std::vector<u64>(GAP_BINS);
+        std::vector<u64> runs = std::vector<u64>(RUN_BINS);
+        std::vector<u64> complexity = std::vector<u64>(7);
+        std::vector<std::vector<u64>> windows = make_windows();
+        std::array<u64, WINDOWS.size()> windows_out_of_range{};
+
+        static std::vector<std::vector<u64>> make_windows() {
+            std::vector<std::vector<u64>> w;
+            for(const auto& [min, max] : WINDOWS){
+                w.emplace_back(static_cast<std::size_t>(max - min + 1));
+            }
+            return w;
+        }
+
+        static std::vector<double> poisson_probabilities(double lambda, std::size_t bins) {
+            std::vector<double> p(bins);
+            double term = std::exp(-lambda);
+            double sum = 0.0;
+            for(std::size_t k = 0; k + 1 < bins; ++k){
+                p[k] = term;
+                sum += term;
+                term *= lambda / static_cast<double>(k + 1);
+            }
+            p[bins - 1] = 1.0 - sum;
+            return p;
+        }
+
+        void test_birthdays(const std::vector<result_type>& raw, bool high) {
+            std::vector<u32> days(BIRTHDAYS);
+            std::vector<u32> spacings(BIRTHDAYS);
+            for(std::size_t trial = 0; trial + BIRTHDAYS <= raw.size(); trial += BIRTHDAYS){
+                for(std::size_t i = 0; i < BIRTHDAYS; ++i){
+                    days[i] = detail::bits32<Engine>(raw[trial + i], high);
+                }
+                std::sort(days.begin(), days.end());
+                spacings[0] = days[0];
+                for(std::size_t i = 1; i < BIRTHDAYS; ++i){
+                    spacings[i] = days[i] - days[i - 1];
+                }
+                std::sort(spacings.begin(), spacings.end());
+                std::size_t duplicates = 0;
+                for(std::size_t i = 1; i < BIRTHDAYS; ++i){
+                    duplicates += (spacings[i] == spacings[i - 1]);
+                }
+                ++birthdays[high ? 0 : 1][std::min(duplicates, POISSON_BINS - 1)];
+            }
+        }
+
+        void test_gaps(const std::vector<result_type>& raw) {
+            std::size_t gap = 0;
+            for(auto x : raw){
+                const double u = detail::to_unit<Engine>(x);
+                if(u >= GAP_LO && u < GAP_HI){
+                    ++gaps[std::min(gap, GAP_BINS - 1)];
+                    gap = 0;
+                } else {
+                    ++gap;
+                }
+            }
+        }
+
+        void test_runs(const std::vector<result_type>& raw) {
+            //runs up, discarding the element following each run so that run lengths are independent
+            std::size_t i = 0;
+            while(i + 1 < raw.size()){
+                std::size_t length = 1;
+                double last = detail::to_unit<Engine>(raw[i++]);
+                while(i < raw.size()){
+                    const double u = detail::to_unit<Engine>(raw[i++]);
+                    if(u <= last){ break; }
+                    last = u;
+                    ++length;
+                }
+                ++runs[std::min(length, RUN_BINS) - 1];
+                ++i; //discard
+            }
+        }
+
+        void test_complexity(const std::vector<result_type>& raw, std::size_t M) {
+            //NIST SP 800-22 section 2.10, on bit 0 of consecutive outputs
+            const double sign = (M % 2 == 0) ? 1.0 : -1.0;
+            const double mu = M / 2.0 + (9.0 - sign) / 36.0 - (M / 3.0 + 2.0 / 9.0) / std::pow(2.0, static_cast<double>(M));
+            std::vector<std::uint8_t> block(M);
+            for(std::size_t b = 0; b < COMPLEXITY_BLOCKS_PER_CHUNK && (b + 1) * M <= raw.size(); ++b){
+                for(std::size_t i = 0; i < M; ++i){
+                    block[i] = static_cast<std::uint8_t>(raw[b * M + i] & 1);
+                }
+                const double L = static_cast<double>(detail::berlekamp_massey(block));
+                const double T = sign * (L - mu) + 2.0 / 9.0;
+                std::size_t bin = 6;
+                if(T <= -2.5){ bin = 0; }
+                else if(T <= -1.5){ bin = 1; }
+                else if(T <= -0.5){ bin = 2; }
+                else if(T <= 0.5){ bin = 3; }
+                else if(T <= 1.5){ bin = 4; }
+                else if(T <= 2.5){ bin = 5; }
+                ++complexity[bin];
+            }
+        }
+
+        void test_interface(Engine& e, std::size_t draws) {
+            for(std::size_t i = 0; i < draws; ++i){
+                const auto x = detail::bounded(e, BOUND);
+                ++bounded[std::min<u64>(x, BOUND - 1)]; //out of range values are a chi-square disaster anyway
+            }
+            if constexpr(requires { e.next_2(std::uint16_t{}); }){
+                for(std::size_t i = 0; i < draws; ++i){
+                    const auto [a, b] = e.next_2(static_cast<std::uint16_t>(PAIR_BOUND));
+                    ++pairs[std::min<u64>(a * PAIR_BOUND + b, pairs.size() - 1)];
+                }
+            }
+            if constexpr(requires { e.next_4(std::uint16_t{}); }){
+                for(std::size_t i = 0; i < draws; ++i){
+                    const auto v = e.next_4(static_cast<std::uint16_t>(QUAD_BOUND));
+                    u64 cell = 0;
+                    for(auto x : v){ cell = cell * QUAD_BOUND + x; }
+                    ++quads[std::min<u64>(cell, quads.size() - 1)];
+                }
+            }
+            for(std::size_t i = 0; i < draws; ++i){
+                const float f = detail::normalized(e);
+                if(!(f >= 0.0f && f < 1.0f)){
+                    ++floats_out_of_range;
+                    continue;
+                }
+                ++floats[std::min(static_cast<std::size_t>(f * FLOAT_BINS), FLOAT_BINS - 1)];
+            }
+            for(std::size_t i = 0; i < draws; ++i){
+                const auto w = i % WINDOWS.size();
+                const auto [min, max] = WINDOWS[w];
+                const int x = detail::between(e, min, max);
+                if(x < min || x > max){
+                    ++windows_out_of_range[w];
+                    continue;
+                }
+                ++windows[w][static_cast<std::size_t>(x - min)];
+            }
+        }
+
+    public:
+        static constexpr bool has_next_2 = requires(Engine & e) { e.next_2(std::uint16_t{}); };
+        static constexpr bool has_next_4 = requires(Engine & e) { e.next_4(std::uint16_t{}); };
+
+        void consume(Engine& e, std::size_t words, std::size_t complexity_block) {
+            std::vector<result_type> raw(words);
+            for(auto& x : raw){
+                x = e.next();
+            }
+            test_birthdays(raw, true);
+            if constexpr(BITS == 64){
+                test_birthdays(raw, false);
+            }
+            test_gaps(raw);
+            test_runs(raw);
+            test_complexity(raw, complexity_block);
+            test_interface(e, words / 16);
+        }
+
+        void merge(const battery& other) {
+            const auto add = [](auto& into, const auto& from){
+                for(std::size_t i = 0; i < into.size(); ++i){ into[i] += from[i]; }
+            };
+            add(bounded, other.bounded);
+            add(pairs, other.pairs);
+            add(quads, other.quads);
+            add(floats, other.floats);
+            floats_out_of_range += other.floats_out_of_range;
+            add(birthdays[0], other.birthdays[0]);
+            add(birthdays[1], other.birthdays[1]);
+            add(gaps, other.gaps);
+            add(runs, other.runs);
+            add(complexity, other.complexity);
+            for(std::size_t w = 0; w < windows.size(); ++w){
+                add(windows[w], other.windows[w]);
+            }
+            add(windows_out_of_range, other.windows_out_of_range);
+        }
+
+        std::vector<test_result> results(std::size_t complexity_block) const {
+            using stats::uniform_test;
+            using stats::chi_square_test;
+            std::vector<test_result> out;
+            out.push_back(uniform_test("next(" + std::to_string(BOUND) + ")", bounded));
+            if constexpr(has_next_2){
+                out.push_back(uniform_test("next_2(" + std::to_string(PAIR_BOUND) + ") joint", pairs));
+            }
+            if constexpr(has_next_4){
+                out.push_back(uniform_test("next_4(" + std::to_string(QUAD_BOUND) + ") joint", quads));
+            }
+            auto f = uniform_test("normalized<float>", floats);
+            if(floats_out_of_range > 0){
+                f.p_value = 0.0;
+                f.note = std::to_string(floats_out_of_range) + " values outside [0, 1)";
+            }
+            out.push_back(std::move(f));
+
+            const auto poisson = poisson_probabilities(BIRTHDAY_LAMBDA, POISSON_BINS);
+            out.push_back(chi_square_test("birthday spacings, high 32 bits", birthdays[0], poisson));
+            if constexpr(BITS == 64){
+                out.push_back(chi_square_test("birthday spacings, low 32 bits", birthdays[1], poisson));
+            }
+
+            std::vector<double> gap_p(GAP_BINS);
+            const double p = GAP_HI - GAP_LO;
+            for(std::size_t r = 0; r + 1 < GAP_BINS; ++r){
+                gap_p[r] = p * std::pow(1.0 - p, static_cast<double>(r));
+            }
+            gap_p[GAP_BINS - 1] = std::pow(1.0 - p, static_cast<double>(GAP_BINS - 1));
+            out.push_back(chi_square_test("gap [0, 0.25)", gaps, gap_p));
+
+            std::vector<double> run_p(RUN_BINS);
+            double factorial = 1.0; //k!
+            for(std::size_t k = 1; k < RUN_BINS; ++k){
+                //P(run length == k) = 1/k! - 1/(k+1)!
+                run_p[k - 1] = 1.0 / factorial / static_cast<double>(k) - 1.0 / factorial / static_cast<double>(k) / static_cast<double>(k + 1);
+                factorial *= static_cast<double>(k);
+            }
+            run_p[RUN_BINS - 1] = 1.0 / (factorial * static_cast<double>(RUN_BINS));
+            out.push_back(chi_square_test("runs up", runs, run_p));
+
+            const std::vector<double> nist{0.010417, 0.03125, 0.125, 0.5, 0.25, 0.0625, 0.020833};
+            out.push_back(chi_square_test("linear complexity, bit 0, M=" + std::to_string(complexity_block), complexity, nist));
+
+            double chi2 = 0.0, dof = 0.0;
+            u64 out_of_range = 0;
+            std::string note;
+            for(std::size_t w = 0; w < windows.size(); ++w){
+                auto counts = windows[w];
+                if(counts.back() == 0){ //the engine treats between(min, max) as half-open
+                    counts.pop_back();
+                    note = "half-open";
+                }
+                const auto [c, d] = stats::chi_square(counts, std::vector<double>(counts.size(), 1.0 / counts.size()));
+                chi2 += c;
+                dof += d;
+                out_of_range += windows_out_of_range[w];
+            }
+            test_result between{"between(min, max) windows", chi2, stats::chi_square_p(chi2, dof), note};
+            if(out_of_range > 0){
+                between.p_value = 0.0;
+                between.note = std::to_string(out_of_range) + " values outside [min, max]";
+            }
+            out.push_back(std::move(between));
+            return out;
+        }
+    };
+
+    // Runs the full battery. MakeEngine is any callable u64 seed -> Engine, so you decide how
+    // a generator gets seeded (eg: [](auto s){ return SmallFast32(seed::to_32(s)); }).
+    template<typename MakeEngine>
+    report run(std::string name, MakeEngine make_engine, const options& opt = {}) {
+        using Engine = std::invoke_result_t<MakeEngine&, u64>;
+        using result_type = detail::result_t<Engine>;
+        const unsigned thread_count = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+        const u64 chunk_words = std::max<u64>(opt.chunk_bytes / sizeof(result_type), opt.complexity_block);
+        const u64 chunk_count = std::max<u64>(1, opt.total_bytes / (chunk_words * sizeof(result_type)));
+
+        std::vector<battery<Engine>> partial(thread_count);
+        std::atomic<u64> next_chunk{0};
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < thread_count; ++t){
+            workers.emplace_back([&, t]{
+                Engine e = make_engine(seed::splitmix64(opt.seed + t));
+                while(next_chunk.fetch_add(1, std::memory_order_relaxed) < chunk_count){
+                    partial[t].consume(e, static_cast<std::size_t>(chunk_words), opt.complexity_block);
+                }
+            });
+        }
+        for(auto& w : workers){
+            w.join();
+        }
+        for(unsigned t = 1; t < thread_count; ++t){
+            partial[0].merge(partial[t]);
+        }
+        return {std::move(name), chunk_count * chunk_words * sizeof(result_type), partial[0].results(opt.complexity_block)};
+    }
+}
+
+/* Example usage:
+#include <fstream>
+#include <iostream>
+#include "SmallFast_32.h"
+#include "SmallFast_64.h"
+#include "PCG32.hpp"
+#include "RomuQuad.hpp"
+#include "RomuTrio.hpp"
+#include "SFC64.hpp"
+#include "WyRand.hpp"
+#include "xoshiro256ss.h"
+#include "quality.hpp"
+
+int main() {
+    quality::options opt;
+    opt.total_bytes = 16ull << 30; //16 GiB per engine
+
+    std::ofstream file("quality_report.txt");
+    bool all_passed = true;
+    for(const auto& r : {
+        quality::run("SmallFast32", [](auto s){ return SmallFast32(seed::to_32(s)); }, opt),
+        quality::run("SmallFast64", [](auto s){ return SmallFast64(s); }, opt),
+        quality::run("PCG32", [](auto s){ return PCG32(s); }, opt),
+        quality::run("xoshiro256**", [](auto s){ return RNG(s); }, opt),
+        quality::run("xoshiro256+", [](auto s){ return Xoshiro256p(s); }, opt), //fails linear complexity of bit 0, by design
+        quality::run("xoshiro128**", [](auto s){ return Xoshiro128ss(s); }, opt),
+        quality::run("RomuTrio", [](auto s){ return RomuTrio(s); }, opt),
+        quality::run("RomuQuad", [](auto s){ return RomuQuad(s); }, opt),
+        quality::run("WyRand", [](auto s){ return WyRand(s); }, opt),
+        quality::run("SFC64", [](auto s){ return SFC64(s); }, opt)}){
+        r.write(std::cout);
+        r.write(file);
+        all_passed &= r.passed();
+    }
+    return all_passed ? 0 : 1;
+}
+*/
@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <semaphore>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
+#if __has_include(<unistd.h>) && __has_include(<fcntl.h>)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define RANDOM_STREAM_POSIX 1
+#endif
+// random_stream<Engine>: the engine's output as a byte stream, in bulk, for random test fixtures and
+// noise files of many gigabytes.
+//
+// The bytes are the engine's words in little-endian order, whatever the platform: the same bytes
+// as a next() loop that stores each word, and successive calls continue the stream where the last
+// one stopped, down to the byte.
+//
+// fill(span<byte>) generates straight into the destination with the engine's bulk path (fill(), or
+// a next() loop on a local copy for engines without one, as buffered.hpp does). A word split between
+// two calls goes through a spill buffer, and a destination where the stream's words can't land on
+// aligned addresses through a 1 KiB scratch block.
+//
+// write(sink, bytes) and write(fd, bytes) run a double-buffered pipeline: two page-aligned blocks
+// of block_bytes, the calling thread generates one while a writer thread hands the other to the
+// sink, so generation and I/O overlap and the slower of the two sets the pace. One write per block
+// of a few MiB keeps syscall overhead negligible, so plain write(2) needs no writev or io_uring.
+// write_file() opens the file with O_DIRECT where the filesystem has it (F_NOCACHE on macOS): tens
+// of GB of noise would otherwise evict the whole page cache for data nobody reads back.
+template<portable::full_range_engine Engine>
+class random_stream {
+public:
+    using u64 = std::uint64_t;
+    using word = std::conditional_t<Engine::max() == std::numeric_limits<std::uint32_t>::max(), std::uint32_t, std::uint64_t>;
+    static constexpr std::size_t BLOCK_BYTES = std::size_t(4) << 20;
+    static constexpr std::size_t PAGE = 4096; //O_DIRECT alignment, for buffers, offsets and sizes
+
+    template<typename... Args>
+        requires std::is_constructible_v<Engine, Args...>
+    explicit random_stream(Args&&... args) noexcept(std::is_nothrow_constructible_v<Engine, Args...>)
+        : engine_(std::forward<Args>(args)...) {}
+
+    // the next out.size() bytes of the stream
+    void fill(std::span<std::byte> out) noexcept {
+        std::size_t i = take_spill(out); //now at a word boundary of the stream, or done
+        const std::size_t words = (out.size() - i) / sizeof(word);
+        if(reinterpret_cast<std::uintptr_t>(out.data() + i) % alignof(word) == 0){
+            // the destination is aligned and only ever accessed as bytes otherwise
+            std::span<word> direct(reinterpret_cast<word*>(out.data() + i), words);
+            generate(direct);
+            to_little_endian(direct);
+        } else { //the word boundaries fall between aligned addresses: through an aligned scratch block
+            std::array<word, SCRATCH_WORDS> scratch;
+            for(std::size_t done = 0; done < words; done += SCRATCH_WORDS){
+                const std::span<word> part(scratch.data(), std::min(SCRATCH_WORDS, words - done));
+                generate(part);
+                to_little_endian(part);
+                std::memcpy(out.data() + i + done * sizeof(word), part.data(), part.size_bytes());
+            }
+        }
+        i += words * sizeof(word);
+        if(i < out.size()){
+            spill();
+            take_spill(out.subspan(i));
+        }
+    }
+
+    // The next bytes of the stream, handed to sink(span<const byte>) in order, block by block, on a
+    // writer thread. Every block but the last is block_bytes (rounded up to a whole page). The spans
+    // are valid during the call only.
+    template<typename Sink>
+        requires std::invocable<Sink&, std::span<const std::byte>>
+    void write(Sink&& sink, u64 bytes, std::size_t block_bytes = BLOCK_BYTES) {
+        pump(bytes, block_bytes, [&](std::span<const std::byte> block){
+            std::invoke(sink, block);
+            return true;
+        });
+    }
+
+#if defined(RANDOM_STREAM_POSIX)
+    // The next bytes of the stream to a file descriptor, from its current position. Works on files,
+    // pipes and sockets, and on descriptors opened with O_DIRECT. Stops at the first error.
+    std::error_code write(int fd, u64 bytes, std::size_t block_bytes = BLOCK_BYTES) {
+        int error = 0;
+        pump(bytes, block_bytes, [&](std::span<const std::byte> block){
+            if(block.size() % PAGE != 0){
+                // O_DIRECT takes whole pages only: write those, then the tail through the page cache
+                const int flags = direct_flag() ? ::fcntl(fd, F_GETFL) : 0;
+                if(flags != -1 && (flags & direct_flag()) != 0){
+                    const std::size_t head = block.size() - block.size() % PAGE;
+                    error = write_all(fd, block.first(head));
+                    if(error == 0 && ::fcntl(fd, F_SETFL, flags & ~direct_flag()) == -1){
+                        error = errno;
+                    }
+                    block = block.subspan(head);
+                }
+            }
+            if(error == 0){
+                error = write_all(fd, block);
+            }
+            return error == 0;
+        });
+        return {error, std::generic_category()};
+    }
+
+    // A new file of the next bytes of the stream. direct: bypass the page cache where possible
+    // (O_DIRECT, or F_NOCACHE on macOS); filesystems without O_DIRECT (tmpfs) get a normal file.
+    std::error_code write_file(const char* path, u64 bytes, bool direct = true, std::size_t block_bytes = BLOCK_BYTES) {
+        constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        int fd = -1;
+        if(direct && direct_flag() != 0){
+            fd = ::open(path, flags | direct_flag(), 0644);
+        }
+        if(fd == -1){
+            fd = ::open(path, flags, 0644);
+            if(fd == -1){
+                return {errno, std::generic_category()};
+            }
+#if defined(F_NOCACHE)
+            if(direct){
+                ::fcntl(fd, F_NOCACHE, 1);
+            }
+#endif
+        }
+        std::error_code result = write(fd, bytes, block_bytes);
+        if(::close(fd) == -1 && !result){
+            result = {errno, std::generic_category()};
+        }
+        return result;
+    }
+#endif
+
+    constexpr Engine& engine() noexcept { return engine_; }
+    constexpr const Engine& engine() const noexcept { return engine_; }
+
+private:
+    Engine engine_;
+    std::array<std::byte, sizeof(word)> spill_{}; //the rest of a word split between two calls
+    std::size_t spill_left_ = 0;                  //at the end of spill_
+
+    struct page_deleter {
+        void operator()(std::byte* p) const noexcept {
+            ::operator delete[](p, std::align_val_t{PAGE});
+        }
+    };
+    using block_ptr = std::unique_ptr<std::byte[], page_deleter>;
+
+    static constexpr std::size_t SCRATCH_WORDS = 1024 / sizeof(word); //1 KiB on the stack, stays in L1
+
+    static void to_little_endian(std::span<word> words) noexcept {
+        if constexpr(std::endian::native == std::endian::big){
+            for(auto& w : words){
+                word r = 0;
+                for(std::size_t b = 0; b < sizeof(word); ++b){
+                    r = static_cast<word>((r << 8) | ((w >> (8 * b)) & 0xFF));
+                }
+                w = r;
+            }
+        }
+    }
+
+    std::size_t take_spill(std::span<std::byte> out) noexcept {
+        const std::size_t n = std::min(spill_left_, out.size());
+        std::memcpy(out.data(), spill_.data() + (sizeof(word) - spill_left_), n);
+        spill_left_ -= n;
+        return n;
+    }
+
+    void spill() noexcept {
+        word w;
+        generate(std::span<word>(&w, 1));
+        for(std::size_t b = 0; b < sizeof(word); ++b){
+            spill_[b] = static_cast<std::byte>(w >> (8 * b));
+        }
+        spill_left_ = sizeof(word);
+    }
+
+    void generate(std::span<word> out) noexcept {
+        if constexpr(requires(Engine& e){ e.fill(out); }){
+            engine_.fill(out);
+        } else if constexpr(sizeof(Engine) <= 64){
+            Engine copy = engine_; //see engine_interface::fill
+            for(auto& v : out){
+                v = static_cast<word>(copy());
+            }
+            engine_ = copy;
+        } else { //too big to copy per call (std::mt19937 is 5KB)
+            for(auto& v : out){
+                v = static_cast<word>(engine_());
+            }
+        }
+    }
+
+    // Fills blocks on this thread while a writer thread consumes the other buffer. consume returns
+    // false to stop: blocks already generated are dropped, and no more are generated.
+    template<typename Consume>
+    void pump(u64 bytes, std::size_t block_bytes, Consume&& consume) {
+        block_bytes = std::max(PAGE, (block_bytes + PAGE - 1) / PAGE * PAGE);
+        std::array<block_ptr, 2> buffers{
+            block_ptr(new(std::align_val_t{PAGE}) std::byte[block_bytes]),
+            block_ptr(new(std::align_val_t{PAGE}) std::byte[block_bytes])};
+        std::array<std::size_t, 2> sizes{};
+        std::array<std::binary_semaphore, 2> full{std::binary_semaphore(0), std::binary_semaphore(0)};
+        std::array<std::binary_semaphore, 2> empty{std::binary_semaphore(1), std::binary_semaphore(1)};
+        std::atomic<bool> stopped{false};
+
+        std::thread writer([&]{
+            for(std::size_t b = 0; ; b ^= 1){
+                full[b].acquire();
+                if(sizes[b] == 0){ //end of stream
+                    return;
+                }
+                if(!stopped.load(std::memory_order_relaxed) && !consume(std::span<const std::byte>(buffers[b].get(), sizes[b]))){
+                    stopped.store(true, std::memory_order_relaxed);
+                }
+                empty[b].release();
+            }
+        });
+        std::size_t b = 0;
+        for(; bytes > 0 && !stopped.load(std::memory_order_relaxed); b ^= 1){
+            const auto n = static_cast<std::size_t>(std::min<u64>(bytes, block_bytes));
+            empty[b].acquire();
+            fill(std::span<std::byte>(buffers[b].get(), n));
+            sizes[b] = n;
+            full[b].release();
+            bytes -= n;
+        }
+        empty[b].acquire();
+        sizes[b] = 0;
+        full[b].release();
+        writer.join();
+    }
+
+#if defined(RANDOM_STREAM_POSIX)
+    static constexpr int direct_flag() noexcept {
+#if defined(O_DIRECT)
+        return O_DIRECT;
+#else
+        return 0;
+#endif
+    }
+
+    static int write_all(int fd, std::span<const std::byte> data) noexcept {
+        while(!data.empty()){
+            const auto written = ::write(fd, data.data(), data.size());
+            if(written == -1){
+                if(errno == EINTR){
+                    continue;
+                }
+                return errno;
+            }
+            data = data.subspan(static_cast<std::size_t>(written));
+        }
+        return 0;
+    }
+#endif
+};
+
+/* Example usage:
+#include <cstdio>
+#include <vector>
+#include "random_stream.hpp"
+#include "SmallFast_64.h"
+
+int main() {
+    random_stream<SmallFast64> noise(42);
+
+    // in memory: the engine writes straight into the buffer
+    std::vector<std::byte> fixture(1 << 30);
+    noise.fill(fixture);
+
+    // 20 GB to disk, generating the next 4 MiB block while the last one is written
+    if(auto error = noise.write_file("noise.bin", 20'000'000'000ull)){
+        std::fprintf(stderr, "noise.bin: %s\n", error.message().c_str());
+        return 1;
+    }
+
+    // or anywhere else, block by block on the writer thread
+    std::uint64_t checksum = 0;
+    noise.write([&](std::span<const std::byte> block){ checksum += block.size(); }, 1ull << 30);
+    return checksum == (1ull << 30) ? 0 : 1;
+}
+*/
@@ -0,0 +1,746 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <source_location>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "seed.hpp"
+// Draw recording and replay, for finding where two runs of a simulation diverge.
+//
+// recording_rng<Engine> IS an Engine (it derives from it) whose drawing methods - next(), next(bound),
+// operator(), between(), normalized(), unit_range(), coinToss(), next_gaussian(), next_2/next_4,
+// inRange(), uniformRandom(), getNumber(), color() - log a record of every call: the call site (file
+// and line, captured with a defaulted std::source_location argument, so call sites don't change), the
+// method, its bound and the result. Bulk draws (fill, fill_normalized, fill_bounded, next_bounded) and
+// child generators (split, clone_independent) log one record each, with the element count and a hash
+// of the output (of the child's first outputs) as the result. Methods the engine doesn't have aren't
+// offered. Methods that only move or read the state (discard, advance, jump, get_state, ...) are
+// inherited unchanged.
+//
+// Records go to the draw_log installed on the calling thread with a recording::capture scope. A draw_log
+// is a single-producer single-consumer lock-free ring of varint encoded records (about 6-12 bytes
+// each): the simulation thread writes, any one other thread may drain() concurrently. When the ring is
+// full records are dropped and counted, never blocked on.
+//
+// replaying_rng<Engine> returns the values of a recording inside a recording::replay scope, and
+// remembers the first call that doesn't match the recording (different call site, method or bound).
+// That is the point where your two runs diverged. It still draws from the engine on every call, so
+// the engine stays in step with the recorded run: bulk draws and children can't be answered from a
+// hash, they come from the engine and are compared with the recorded hash, so replay them from the
+// same seed as the recording.
+//
+// Switch with PRNG_RECORDING: 0 (default) makes recording::traced<Engine> a plain alias of Engine, so
+// release builds pay nothing. 1 makes it a recording_rng, 2 a replaying_rng.
+#ifndef PRNG_RECORDING
+#define PRNG_RECORDING 0
+#endif
+
+namespace recording {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+    using u8 = std::uint8_t;
+
+    enum class method : u8 {
+        next, next_bounded, between, normalized, unit_range, coin_toss, gaussian, batch, in_range, color,
+        uniform_random, bulk, child
+    };
+
+    inline const char* to_string(method m) noexcept {
+        constexpr std::array<const char*, 13> names{
+            "next", "next(bound)", "between", "normalized", "unit_range", "coinToss", "next_gaussian", "next_2/next_4", "inRange", "color",
+            "uniformRandom", "fill/next_bounded", "split/clone_independent"
+        };
+        const auto i = static_cast<std::size_t>(m);
+        return i < names.size() ? names[i] : "unknown";
+    }
+
+    struct record {
+        u32 file = 0;        //hash of the source file name, see file_name()
+        u32 line = 0;
+        method kind = method::next;
+        u64 arg = 0;         //the bound or range width (as bits for floats), the count of a bulk draw, or 0
+        u64 result = 0;      //the returned value as bits (zigzag for signed integers), or the hash of a bulk draw or child
+
+        constexpr bool same_call(const record& other) const noexcept {
+            return file == other.file && line == other.line && kind == other.kind && arg == other.arg;
+        }
+        constexpr bool operator==(const record&) const noexcept = default;
+    };
+
+    namespace detail {
+        // Registry from file hash to file name, so reports can print names. Lock-free, insert only.
+        struct file_slot {
+            std::atomic<u32> tag{0};
+            std::atomic<const char*> name{nullptr};
+        };
+        inline std::array<file_slot, 1024> files{};
+
+        inline void register_file(u32 tag, const char* name) noexcept {
+            for(std::size_t probe = 0, i = tag % files.size(); probe < files.size(); ++probe, i = (i + 1) % files.size()){
+                u32 expected = files[i].tag.load(std::memory_order_acquire);
+                if(expected == 0 && files[i].tag.compare_exchange_strong(expected, tag, std::memory_order_acq_rel)){
+                    files[i].name.store(name, std::memory_order_release);
+                    return;
+                }
+                if(expected == tag){
+                    return;
+                }
+            }
+        }
+
+        // hashes the file name, cached per thread since consecutive draws mostly come from the same file
+        inline u32 file_tag(const char* file) noexcept {
+            thread_local const char* last_file = nullptr;
+            thread_local u32 last_tag = 0;
+            if(file != last_file){
+                const u64 h = seed::fnv1a(file);
+                last_tag = seed::to_32(h) | 1u; //0 marks an empty registry slot
+                last_file = file;
+                register_file(last_tag, file);
+            }
+            return last_tag;
+        }
+
+        inline void put_varint(std::byte*& p, u64 v) noexcept {
+            while(v >= 0x80){
+                *p++ = static_cast<std::byte>((v & 0x7F) | 0x80);
+                v >>= 7;
+            }
+            *p++ = static_cast<std::byte>(v);
+        }
+
+        inline bool get_varint(std::span<const std::byte> bytes, std::size_t& pos, u64& v) noexcept {
+            v = 0;
+            for(int shift = 0; shift < 64 && pos < bytes.size(); shift += 7){
+                const auto b = static_cast<u64>(bytes[pos++]);
+                v |= (b & 0x7F) << shift;
+                if(!(b & 0x80)){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // header byte: method in the low 4 bits, then flags
+        inline constexpr u8 HAS_ARG = 0x10;
+        inline constexpr u8 SAME_FILE = 0x20;
+        inline constexpr std::size_t MAX_RECORD_BYTES = 1 + 5 + 5 + 10 + 10;
+
+        // results as u64 bits and back: zigzag for signed integers so small negatives stay short
+        template<typename T>
+        struct bits;
+
+        template<typename T>
+            requires std::integral<T> || std::is_enum_v<T>
+        struct bits<T> {
+            static constexpr u64 to(T v) noexcept {
+                if constexpr(std::is_enum_v<T>){
+                    return bits<std::underlying_type_t<T>>::to(static_cast<std::underlying_type_t<T>>(v));
+                } else if constexpr(std::is_signed_v<T>){
+                    const auto s = static_cast<std::int64_t>(v);
+                    return (static_cast<u64>(s) << 1) ^ static_cast<u64>(s >> 63);
+                } else {
+                    return static_cast<u64>(v);
+                }
+            }
+            static constexpr T from(u64 b) noexcept {
+                if constexpr(std::is_enum_v<T>){
+                    return static_cast<T>(bits<std::underlying_type_t<T>>::from(b));
+                } else if constexpr(std::is_signed_v<T>){
+                    return static_cast<T>(static_cast<std::int64_t>(b >> 1) ^ -static_cast<std::int64_t>(b & 1));
+                } else {
+                    return static_cast<T>(b);
+                }
+            }
+        };
+
+        template<std::floating_point T>
+        struct bits<T> {
+            using U = std::conditional_t<sizeof(T) == 4, u32, u64>;
+            static_assert(sizeof(T) == sizeof(U), "recording: unsupported floating point type");
+            static constexpr u64 to(T v) noexcept { return std::bit_cast<U>(v); }
+            static constexpr T from(u64 b) noexcept { return std::bit_cast<T>(static_cast<U>(b)); }
+        };
+
+        template<std::integral A, std::integral B>
+        struct bits<std::pair<A, B>> {
+            static_assert(sizeof(A) <= 4 && sizeof(B) <= 4);
+            static constexpr u64 to(std::pair<A, B> v) noexcept { return static_cast<u64>(static_cast<u32>(v.first)) | static_cast<u64>(static_cast<u32>(v.second)) << 32; }
+            static constexpr std::pair<A, B> from(u64 b) noexcept { return {static_cast<A>(b), static_cast<B>(b >> 32)}; }
+        };
+
+        template<>
+        struct bits<std::array<std::uint16_t, 4>> {
+            static constexpr u64 to(const std::array<std::uint16_t, 4>& v) noexcept {
+                return v[0] | u64(v[1]) << 16 | u64(v[2]) << 32 | u64(v[3]) << 48;
+            }
+            static constexpr std::array<std::uint16_t, 4> from(u64 b) noexcept {
+                return {std::uint16_t(b), std::uint16_t(b >> 16), std::uint16_t(b >> 32), std::uint16_t(b >> 48)};
+            }
+        };
+
+        // hash of a bulk draw's output
+        template<typename T>
+        constexpr u64 hash(std::span<const T> values) noexcept {
+            u64 h = values.size();
+            for(const T& v : values){
+                h = seed::splitmix64(h ^ bits<T>::to(v));
+            }
+            return h;
+        }
+
+        // hash of a child generator: its first outputs, or its bytes for engines that only draw
+        // through their own methods (BasicRandom)
+        template<typename E>
+        u64 fingerprint(const E& child) noexcept {
+            if constexpr(requires(E& e){ { e() } -> std::unsigned_integral; }){
+                E copy = child;
+                u64 h = 0;
+                for(int i = 0; i < 4; ++i){
+                    h = seed::splitmix64(h ^ static_cast<u64>(copy()));
+                }
+                return h;
+            } else {
+                static_assert(std::has_unique_object_representations_v<E>, "recording: can't hash this child generator.");
+                std::array<std::byte, sizeof(E)> raw;
+                std::memcpy(raw.data(), &child, sizeof(E));
+                return hash<std::byte>(raw);
+            }
+        }
+
+        template<typename T>
+        constexpr u64 width(T min, T max) noexcept {
+            if constexpr(std::is_floating_point_v<T>){
+                return bits<T>::to(max - min);
+            } else {
+                return static_cast<u64>(max) - static_cast<u64>(min);
+            }
+        }
+    }
+
+    // name of the file a record came from, if it was seen in this process
+    inline const char* file_name(u32 file) noexcept {
+        for(std::size_t probe = 0, i = file % detail::files.size(); probe < detail::files.size(); ++probe, i = (i + 1) % detail::files.size()){
+            const u32 tag = detail::files[i].tag.load(std::memory_order_acquire);
+            if(tag == file){
+                const char* name = detail::files[i].name.load(std::memory_order_acquire);
+                return name ? name : "<unknown file>";
+            }
+            if(tag == 0){
+                break;
+            }
+        }
+        return "<unknown file>";
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const record& r) {
+        os << file_name(r.file) << ':' << r.line << ' ' << to_string(r.kind);
+        if(r.arg != 0){
+            os << " arg=" << r.arg;
+        }
+        return os << " -> " << r.result;
+    }
+
+    // Decodes records from the bytes of a draw_log, in order.
+    class reader {
+    public:
+        explicit reader(std::span<const std::byte> bytes) noexcept : bytes_(bytes) {}
+
+        std::optional<record> next() noexcept {
+            if(pos_ >= bytes_.size()){
+                return std::nullopt;
+            }
+            const auto header = static_cast<u8>(bytes_[pos_++]);
+            record r;
+            r.kind = static_cast<method>(header & 0x0F);
+            u64 v = 0;
+            if(header & detail::SAME_FILE){
+                r.file = previous_file_;
+            } else {
+                if(!detail::get_varint(bytes_, pos_, v)){ return fail(); }
+                r.file = static_cast<u32>(v);
+            }
+            if(!detail::get_varint(bytes_, pos_, v)){ return fail(); }
+            r.line = static_cast<u32>(v);
+            if(header & detail::HAS_ARG){
+                if(!detail::get_varint(bytes_, pos_, r.arg)){ return fail(); }
+            }
+            if(!detail::get_varint(bytes_, pos_, r.result)){ return fail(); }
+            previous_file_ = r.file;
+            ++count_;
+            return r;
+        }
+
+        u64 records_read() const noexcept { return count_; }
+
+    private:
+        std::optional<record> fail() noexcept {
+            pos_ = bytes_.size();
+            return std::nullopt;
+        }
+        std::span<const std::byte> bytes_;
+        std::size_t pos_ = 0;
+        u32 previous_file_ = 0;
+        u64 count_ = 0;
+    };
+
+    inline std::vector<record> decode(std::span<const std::byte> bytes) {
+        std::vector<record> out;
+        reader r(bytes);
+        while(auto rec = r.next()){
+            out.push_back(*rec);
+        }
+        return out;
+    }
+
+    // Single-producer single-consumer lock-free ring of encoded records. Capacity is rounded up to a
+    // power of two bytes.
+    class draw_log {
+    public:
+        explicit draw_log(std::size_t capacity_bytes = std::size_t(1) << 22)
+            : buffer_(std::bit_ceil(std::max(capacity_bytes, detail::MAX_RECORD_BYTES * 2))), mask_(buffer_.size() - 1) {}
+
+        draw_log(const draw_log&) = delete;
+        draw_log& operator=(const draw_log&) = delete;
+
+        // producer side. Returns false, and counts a drop, when the ring is full.
+        bool push(const record& r) noexcept {
+            std::array<std::byte, detail::MAX_RECORD_BYTES> encoded;
+            std::byte* p = encoded.data();
+            u8 header = static_cast<u8>(r.kind);
+            if(r.arg != 0){ header |= detail::HAS_ARG; }
+            if(r.file == previous_file_){ header |= detail::SAME_FILE; }
+            *p++ = static_cast<std::byte>(header);
+            if(r.file != previous_file_){ detail::put_varint(p, r.file); }
+            detail::put_varint(p, r.line);
+            if(r.arg != 0){ detail::put_varint(p, r.arg); }
+            detail::put_varint(p, r.result);
+            const auto n = static_cast<std::size_t>(p - encoded.data());
+
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            const std::size_t tail = tail_.load(std::memory_order_acquire);
+            if(buffer_.size() - (head - tail) < n){
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                previous_file_ = 0; //the next record must not refer to the dropped one
+                return false;
+            }
+            for(std::size_t i = 0; i < n; ++i){
+                buffer_[(head + i) & mask_] = encoded[i];
+            }
+            previous_file_ = r.file;
+            head_.store(head + n, std::memory_order_release);
+            recorded_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // consumer side. Appends everything recorded so far to out, returns the number of bytes.
+        std::size_t drain(std::vector<std::byte>& out) {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            const std::size_t head = head_.load(std::memory_order_acquire);
+            for(std::size_t i = tail; i != head; ++i){
+                out.push_back(buffer_[i & mask_]);
+            }
+            tail_.store(head, std::memory_order_release);
+            return head - tail;
+        }
+
+        std::vector<std::byte> take() {
+            std::vector<std::byte> out;
+            drain(out);
+            return out;
+        }
+
+        u64 recorded() const noexcept { return recorded_.load(std::memory_order_relaxed); }
+        u64 dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<std::byte> buffer_;
+        std::size_t mask_;
+        u32 previous_file_ = 0;
+        alignas(64) std::atomic<std::size_t> head_{0};
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        std::atomic<u64> recorded_{0};
+        std::atomic<u64> dropped_{0};
+    };
+
+    // The first call that didn't match the recording.
+    struct mismatch {
+        u64 index;                          //number of draws replayed before it
+        std::optional<record> expected;     //nullopt if the recording ran out
+        record actual;                      //result: 0 for single draws, this run's hash for bulk draws and children
+        std::source_location where;
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, const mismatch& m) {
+        os << "draw #" << m.index << " diverged at " << m.where.file_name() << ':' << m.where.line()
+            << " (" << m.where.function_name() << "), " << to_string(m.actual.kind);
+        if(m.actual.arg != 0){
+            os << " arg=" << m.actual.arg;
+        }
+        if(m.expected){
+            return os << "; recorded: " << *m.expected;
+        }
+        return os << "; the recording ended";
+    }
+
+    class capture;
+    class replay;
+
+    namespace detail {
+        inline thread_local draw_log* active_log = nullptr;
+        inline thread_local replay* active_replay = nullptr;
+    }
+
+    // Installs a draw_log for recording_rngs used on this thread, for the lifetime of the scope.
+    class capture {
+    public:
+        explicit capture(draw_log& log) noexcept : previous_(detail::active_log) {
+            detail::active_log = &log;
+        }
+        ~capture() { detail::active_log = previous_; }
+        capture(const capture&) = delete;
+        capture& operator=(const capture&) = delete;
+    private:
+        draw_log* previous_;
+    };
+
+    // Answers replaying_rng draws on this thread from a recording, for the lifetime of the scope.
+    // The bytes must outlive the scope.
+    class replay {
+    public:
+        explicit replay(std::span<const std::byte> recording) noexcept : reader_(recording), previous_(detail::active_replay) {
+            detail::active_replay = this;
+        }
+        ~replay() { detail::active_replay = previous_; }
+        replay(const replay&) = delete;
+        replay& operator=(const replay&) = delete;
+
+        const std::optional<mismatch>& first_mismatch() const noexcept { return mismatch_; }
+        bool diverged() const noexcept { return mismatch_.has_value(); }
+        u64 draws() const noexcept { return draws_; }
+
+        // the recorded result of the next draw, or nullopt once the recording ran out
+        std::optional<u64> answer(const record& call, const std::source_location& where) noexcept {
+            const auto expected = reader_.next();
+            if(!mismatch_ && (!expected || !expected->same_call(call))){
+                mismatch_ = mismatch{draws_, expected, call, where};
+            }
+            ++draws_;
+            if(!expected){
+                return std::nullopt;
+            }
+            return expected->result;
+        }
+
+        // a bulk draw or child, whose call.result (the hash of this run's output) must match as well
+        void check(const record& call, const std::source_location& where) noexcept {
+            const auto expected = reader_.next();
+            if(!mismatch_ && (!expected || !(*expected == call))){
+                mismatch_ = mismatch{draws_, expected, call, where};
+            }
+            ++draws_;
+        }
+
+    private:
+        reader reader_;
+        replay* previous_;
+        std::optional<mismatch> mismatch_;
+        u64 draws_ = 0;
+    };
+
+    namespace detail {
+        // Every recordable method of Engine, each routed through Derived::draw_impl(call, where, produce).
+        template<typename Derived, typename Engine>
+        class traced_engine : public Engine {
+        public:
+            using Engine::Engine;
+            using location = std::source_location;
+
+            traced_engine() = default;
+            explicit traced_engine(const Engine& e) : Engine(e) {}
+
+            Engine& engine() noexcept { return *this; }
+            const Engine& engine() const noexcept { return *this; }
+
+            auto next(location loc = location::current()) requires requires(Engine& e){ e.next(); } {
+                return draw(method::next, 0, loc, [&]{ return Engine::next(); });
+            }
+
+            template<std::integral B>
+                requires requires(Engine& e, B b){ e.next(b); }
+            auto next(B bound, location loc = location::current()) {
+                return draw(method::next_bounded, bits<B>::to(bound), loc, [&]{ return Engine::next(bound); });
+            }
+
+            auto operator()(location loc = location::current()) requires requires(Engine& e){ e(); } {
+                return draw(method::next, 0, loc, [&]{ return Engine::operator()(); });
+            }
+
+            template<std::integral B>
+                requires requires(Engine& e, B b){ e(b); }
+            auto operator()(B bound, location loc = location::current()) {
+                return draw(method::next_bounded, bits<B>::to(bound), loc, [&]{ return Engine::operator()(bound); });
+            }
+
+            template<typename T>
+                requires requires(Engine& e, T a){ e.between(a, a); }
+            T between(T min, T max, location loc = location::current()) {
+                return draw(method::between, width(min, max), loc, [&]{ return static_cast<T>(Engine::between(min, max)); });
+            }
+
+            template<typename T>
+                requires requires(Engine& e, T a){ e.getNumber(a, a); }
+            T getNumber(T min, T max, location loc = location::current()) {
+                return draw(method::between, width(min, max), loc, [&]{ return static_cast<T>(Engine::getNumber(min, max)); });
+            }
+
+            template<typename T = float>
+                requires requires(Engine& e){ e.template normalized<T>(); } || requires(Engine& e){ e.normalized(); }
+            T normalized(location loc = location::current()) {
+                return draw(method::normalized, 0, loc, [&]{
+                    if constexpr(requires(Engine& e){ e.template normalized<T>(); }){
+                        return Engine::template normalized<T>();
+                    } else {
+                        return static_cast<T>(Engine::normalized());
+                    }
+                });
+            }
+
+            template<typename T = float>
+                requires requires(Engine& e){ e.template unit_range<T>(); } || requires(Engine& e){ e.unit_range(); }
+            T unit_range(location loc = location::current()) {
+                return draw(method::unit_range, 0, loc, [&]{
+                    if constexpr(requires(Engine& e){ e.template unit_range<T>(); }){
+                        return Engine::template unit_range<T>();
+                    } else {
+                        return static_cast<T>(Engine::unit_range());
+                    }
+                });
+            }
+
+            bool coinToss(location loc = location::current()) requires requires(Engine& e){ e.coinToss(); } {
+                return draw(method::coin_toss, 0, loc, [&]{ return static_cast<bool>(Engine::coinToss()); });
+            }
+
+            template<typename T = float>
+                requires requires(Engine& e, T a){ e.next_gaussian(a, a); }
+            T next_gaussian(T mean, T stddev, location loc = location::current()) {
+                return draw(method::gaussian, 0, loc, [&]{ return static_cast<T>(Engine::next_gaussian(mean, stddev)); });
+            }
+
+            template<std::integral B>
+                requires requires(Engine& e, B b){ e.next_2(b); }
+            auto next_2(B bound, location loc = location::current()) {
+                return draw(method::batch, bits<B>::to(bound), loc, [&]{ return Engine::next_2(bound); });
+            }
+
+            template<std::integral B>
+                requires requires(Engine& e, B b){ e.next_4(b); }
+            auto next_4(B bound, location loc = location::current()) {
+                return draw(method::batch, bits<B>::to(bound), loc, [&]{ return Engine::next_4(bound); });
+            }
+
+            template<typename T>
+                requires requires(Engine& e, T a){ e.inRange(a); }
+            T inRange(T range, location loc = location::current()) {
+                return draw(method::in_range, bits<T>::to(range), loc, [&]{ return static_cast<T>(Engine::inRange(range)); });
+            }
+
+            template<typename T>
+                requires requires(Engine& e, T a){ e.inRange(a, a); }
+            T inRange(T from, T to, location loc = location::current()) {
+                return draw(method::in_range, width(from, to), loc, [&]{ return static_cast<T>(Engine::inRange(from, to)); });
+            }
+
+            auto color(location loc = location::current()) requires requires(Engine& e){ e.color(); } {
+                return draw(method::color, 0, loc, [&]{ return Engine::color(); });
+            }
+
+            auto uniformRandom(std::uint64_t range, location loc = location::current()) requires requires(Engine& e){ e.uniformRandom(range); } {
+                return draw(method::uniform_random, range, loc, [&]{ return Engine::uniformRandom(range); });
+            }
+
+            template<typename E = Engine>
+                requires requires(E& e, std::span<typename E::result_type> out){ e.fill(out); }
+            void fill(std::span<typename E::result_type> out, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::fill(out); });
+            }
+
+            template<typename E = Engine>
+                requires requires(E& e, std::span<float> out){ e.fill_normalized(out); }
+            void fill_normalized(std::span<float> out, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::fill_normalized(out); });
+            }
+
+            template<typename E = Engine>
+                requires requires(E& e, std::span<double> out){ e.fill_normalized(out); }
+            void fill_normalized(std::span<double> out, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::fill_normalized(out); });
+            }
+
+            template<typename E = Engine, std::unsigned_integral B>
+                requires requires(E& e, std::span<B> out, B bound){ e.fill_bounded(out, bound); }
+            void fill_bounded(std::span<B> out, B bound, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::fill_bounded(out, bound); });
+            }
+
+            template<typename E = Engine>
+                requires requires(E& e, std::span<const std::uint16_t> bounds, std::span<std::uint16_t> out){ e.next_bounded(bounds, out); }
+            void next_bounded(std::span<const std::uint16_t> bounds, std::span<std::uint16_t> out, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::next_bounded(bounds, out); });
+            }
+
+            template<typename E = Engine>
+                requires requires(E& e, std::uint16_t bound, std::span<std::uint16_t> out){ e.next_bounded(bound, out); }
+            void next_bounded(std::uint16_t bound, std::span<std::uint16_t> out, location loc = location::current()) {
+                bulk(out, loc, [&]{ Engine::next_bounded(bound, out); });
+            }
+
+            auto split(location loc = location::current()) requires requires(Engine& e){ e.split(); } {
+                return child(loc, [&]{ return Engine::split(); });
+            }
+
+            auto clone_independent(location loc = location::current()) requires requires(Engine& e){ e.clone_independent(); } {
+                return child(loc, [&]{ return Engine::clone_independent(); });
+            }
+
+        private:
+            template<typename F>
+            auto draw(method kind, u64 arg, const location& loc, F&& produce) {
+                const record call{file_tag(loc.file_name()), loc.line(), kind, arg, 0};
+                return static_cast<Derived&>(*this).template draw_impl<decltype(produce())>(call, loc, produce);
+            }
+
+            // draws straight from the engine, then logs or checks the count and hash of the output
+            template<typename T, typename F>
+            void bulk(std::span<T> out, const location& loc, F&& produce) {
+                produce();
+                const record call{file_tag(loc.file_name()), loc.line(), method::bulk, out.size(), hash<T>(out)};
+                static_cast<Derived&>(*this).check_impl(call, loc);
+            }
+
+            template<typename F>
+            auto child(const location& loc, F&& produce) {
+                auto result = produce();
+                const record call{file_tag(loc.file_name()), loc.line(), method::child, 0, fingerprint(result)};
+                static_cast<Derived&>(*this).check_impl(call, loc);
+                return result;
+            }
+        };
+    }
+
+    // Logs every draw to the draw_log of the active recording::capture on this thread, if any.
+    template<typename Engine>
+    class recording_rng : public detail::traced_engine<recording_rng<Engine>, Engine> {
+        using base = detail::traced_engine<recording_rng<Engine>, Engine>;
+        friend base;
+
+        template<typename R, typename F>
+        R draw_impl(record call, const std::source_location&, F& produce) {
+            const R result = produce();
+            if(draw_log* log = detail::active_log){
+                call.result = detail::bits<R>::to(result);
+                log->push(call);
+            }
+            return result;
+        }
+
+        void check_impl(const record& call, const std::source_location&) {
+            if(draw_log* log = detail::active_log){
+                log->push(call);
+            }
+        }
+    public:
+        using base::base;
+    };
+
+    // Answers every draw from the active recording::replay scope on this thread, and checks bulk draws
+    // and children against it. The engine draws as well, to stay in step with the recorded run; its
+    // values are returned when no replay is active or the recording ran out.
+    template<typename Engine>
+    class replaying_rng : public detail::traced_engine<replaying_rng<Engine>, Engine> {
+        using base = detail::traced_engine<replaying_rng<Engine>, Engine>;
+        friend base;
+
+        template<typename R, typename F>
+        R draw_impl(const record& call, const std::source_location& loc, F& produce) {
+            const R drawn = produce();
+            if(replay* session = detail::active_replay){
+                if(const auto recorded = session->answer(call, loc)){
+                    return detail::bits<R>::from(*recorded);
+                }
+            }
+            return drawn;
+        }
+
+        void check_impl(const record& call, const std::source_location& loc) {
+            if(replay* session = detail::active_replay){
+                session->check(call, loc);
+            }
+        }
+    public:
+        using base::base;
+    };
+
+#if PRNG_RECORDING == 1
+    template<typename Engine>
+    using traced = recording_rng<Engine>;
+#elif PRNG_RECORDING == 2
+    template<typename Engine>
+    using traced = replaying_rng<Engine>;
+#else
+    template<typename Engine>
+    using traced = Engine;
+#endif
+}
+
+/* Example usage:
+// build the debug run with -DPRNG_RECORDING=1 and the replay with -DPRNG_RECORDING=2
+#include <fstream>
+#include <iostream>
+#include "SmallFast_32.h"
+#include "recording_rng.hpp"
+
+recording::traced<SmallFast32> rng(1234); //the only line that changes
+
+int simulate() {
+    int hp = 100;
+    for(int turn = 0; turn < 1000; ++turn){
+        if(rng.coinToss()){                    //call sites are untouched
+            hp -= rng.between(1, 6);
+        }
+    }
+    return hp;
+}
+
+int main() {
+#if PRNG_RECORDING == 1
+    recording::draw_log log;
+    recording::capture scope(log);
+    simulate();
+    const auto bytes = log.take();
+    std::ofstream("draws.bin", std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    for(const auto& r : recording::decode(bytes)){ std::cout << r << '\n'; } //who drew what
+#elif PRNG_RECORDING == 2
+    std::ifstream file("draws.bin", std::ios::binary);
+    std::vector<char> raw((std::istreambuf_iterator<char>(file)), {});
+    recording::replay scope(std::as_bytes(std::span(raw)));
+    simulate();
+    if(scope.diverged()){
+        std::cout << *scope.first_mismatch() << '\n'; //"draw #212 diverged at sim.cpp:14 ..."
+    }
+#else
+    simulate();
+#endif
+}
+*/
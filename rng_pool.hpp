@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "engine_interface.hpp"
+#if defined(__linux__)
+#include <sched.h>
+#endif
+// A lock-free pool of engines for short-lived tasks that can't own one: coroutines migrate between
+// threads, so thread_local engines are out, and a mutex around one shared engine serializes every
+// core behind a single cache line.
+//
+// rng_pool<Engine> holds a fixed set of engines, pre-seeded from one root with split(). A task leases
+// one, draws, and the lease hands it back on destruction; the engine continues its stream with the
+// next lease. The engines are split into per-CPU shards (the CPU from sched_getcpu, or a hash of the
+// thread id elsewhere). A lease takes the first free engine of its CPU's shard with one atomic
+// exchange on that engine's own flag, and a return is a plain release store of the flag: the same
+// cost as an uncontended mutex, but every CPU has its own engines. A CPU whose shard is all leased
+// takes a free engine from another shard.
+//
+// Every engine shares its cache line(s) with its own flag only, so idle and leased engines never
+// share a line with another core's.
+//
+// Which engine a task gets depends on scheduling, so draws from a pool are not reproducible. Use
+// split() on a task tree's own engines where you need determinism.
+template<random_engine Engine>
+    requires requires(Engine& e){ { e.split() } -> std::same_as<Engine>; }
+class rng_pool {
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    struct alignas(CACHE_LINE) slot {
+        explicit slot(Engine e) noexcept : engine(std::move(e)) {}
+        Engine engine;
+        std::atomic<bool> leased{false};
+    };
+
+public:
+    // RAII ownership of one engine, returned to the pool when destroyed
+    class lease {
+    public:
+        lease(lease&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+        lease& operator=(lease&& other) noexcept {
+            if(this != &other){
+                release();
+                slot_ = std::exchange(other.slot_, nullptr);
+            }
+            return *this;
+        }
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        ~lease() { release(); }
+
+        Engine& engine() const noexcept { return slot_->engine; }
+        Engine& operator*() const noexcept { return engine(); }
+        Engine* operator->() const noexcept { return &engine(); }
+
+    private:
+        friend class rng_pool;
+        explicit lease(slot* s) noexcept : slot_(s) {}
+
+        void release() noexcept {
+            if(slot_){
+                slot_->leased.store(false, std::memory_order_release);
+                slot_ = nullptr;
+            }
+        }
+
+        slot* slot_;
+    };
+
+    // engines_per_shard * shards engines, split from root in order. shards = 0 means one per hardware thread.
+    explicit rng_pool(Engine root, std::size_t engines_per_shard = 4, std::size_t shards = 0)
+        : shard_count_(shards != 0 ? shards : std::max<std::size_t>(1, std::thread::hardware_concurrency())),
+          per_shard_(engines_per_shard),
+          slot_count_(shard_count_ * engines_per_shard) {
+        assert(engines_per_shard > 0 && "rng_pool: needs at least one engine per shard.");
+        slots_ = static_cast<slot*>(::operator new(sizeof(slot) * slot_count_, std::align_val_t{alignof(slot)}));
+        for(std::size_t i = 0; i < slot_count_; ++i){
+            std::construct_at(slots_ + i, root.split());
+        }
+    }
+
+    rng_pool(const rng_pool&) = delete;
+    rng_pool& operator=(const rng_pool&) = delete;
+
+    // all leases must have been returned
+    ~rng_pool() {
+        for(std::size_t i = 0; i < slot_count_; ++i){
+            std::destroy_at(slots_ + i);
+        }
+        ::operator delete(slots_, std::align_val_t{alignof(slot)});
+    }
+
+    // a free engine from this CPU's shard, or from another. nullopt if every engine is leased.
+    std::optional<lease> try_acquire() noexcept {
+        const std::size_t home = current_shard();
+        for(std::size_t i = 0; i < shard_count_; ++i){
+            std::size_t s = home + i;
+            if(s >= shard_count_){ s -= shard_count_; }
+            slot* first = slots_ + s * per_shard_;
+            for(slot* p = first; p != first + per_shard_; ++p){
+                //read before the exchange, so leased engines' lines aren't written to
+                if(!p->leased.load(std::memory_order_relaxed) && !p->leased.exchange(true, std::memory_order_acquire)){
+                    return lease(p);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // like try_acquire, but yields and retries while every engine is leased
+    lease acquire() noexcept {
+        while(true){
+            if(auto l = try_acquire()){
+                return std::move(*l);
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    std::size_t size() const noexcept { return slot_count_; }
+    std::size_t shards() const noexcept { return shard_count_; }
+
+private:
+    std::size_t shard_count_;
+    std::size_t per_shard_;
+    std::size_t slot_count_;
+    slot* slots_ = nullptr;
+
+    std::size_t current_shard() const noexcept {
+#if defined(__linux__)
+        if(const int cpu = sched_getcpu(); cpu >= 0){
+            return static_cast<std::size_t>(cpu) % shard_count_;
+        }
+#endif
+        return std::hash<std::thread::id>{}(std::this_thread::get_id()) % shard_count_;
+    }
+};
+
+/* Example usage:
+#include <iostream>
+#include <mutex>
+#include "benchmark.hpp"
+#include "rng_pool.hpp"
+#include "SmallFast_64.h"
+
+rng_pool<SmallFast64> pool(SmallFast64(42));
+
+// a task that may resume on any thread
+int roll_loot() {
+    auto rng = pool.acquire();              //one atomic exchange on this CPU's own engines
+    return rng->between(1, 100);
+}                                           //returned here, the engine continues its stream next time
+
+int main() {
+    // lease + draw + return, 1 to 128 threads, against one engine behind a mutex
+    SmallFast64 shared(42);
+    std::mutex m;
+    benchmark::options opt;
+    opt.values = 1 << 20;
+    auto results = benchmark::scaling("rng_pool", [](int, std::uint64_t n){
+        std::uint64_t sum = 0;
+        for(std::uint64_t i = 0; i < n; ++i){ sum += pool.acquire()->next(); }
+        return sum;
+    }, opt);
+    const auto locked = benchmark::scaling("mutex", [&](int, std::uint64_t n){
+        std::uint64_t sum = 0;
+        for(std::uint64_t i = 0; i < n; ++i){ std::lock_guard lock(m); sum += shared.next(); }
+        return sum;
+    }, opt);
+    results.insert(results.end(), locked.begin(), locked.end());
+    benchmark::write(std::cout, results);
+    return roll_loot() > 0 ? 0 : 1;
+}
+*/
@@ -0,0 +1,261 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "distributions.hpp"
+#include "portable_math.hpp"
+// Sampling without replacement, for any engine in this repo.
+//
+// std::sample works with our engines, but it's selection sampling: one draw per input element. Picking
+// 100 out of 10 million costs 10 million draws. The algorithms here cost O(k) draws instead:
+//
+// - floyd_sample(n, k, g): Floyd's algorithm (Bentley & Floyd, "A sample of brilliance", 1987).
+//   Exactly k bounded draws, remembered in a small open-addressing hash set. Best for small k.
+// - for_each_sampled_index(n, k, g, f): Vitter's Algorithm D ("An efficient algorithm for sequential
+//   random sampling", 1987). Streams the k indices in ascending order using O(1) memory, skipping
+//   ahead by random distances. Best for large k, or when the indices feed a sequential scan.
+// - reservoir_sample(first, last, out, k, g): Li's Algorithm L ("Reservoir-sampling algorithms of
+//   time complexity O(n(1 + log(N/n)))", 1994). k items from an input range of unknown length in
+//   a single pass, with O(k log(N/k)) draws thanks to geometric skips.
+// - sample_indices(n, k, g): picks between Floyd and Vitter by shape and returns sorted indices.
+//
+// Bounded draws use Lemire's method (portable::bounded, the 64-bit capable sibling of the engines'
+// next(bound)) and the skips use portable::exp/log on open-interval uniforms, so the selected indices
+// are identical on every platform.
+PORTABLE_FP_BEGIN
+namespace sampling {
+    using u64 = std::uint64_t;
+
+    namespace detail {
+        // Minimal open-addressing set of u64, power of two capacity, linear probing.
+        class flat_index_set {
+            static constexpr u64 EMPTY = ~u64(0);
+            std::vector<u64> slots;
+            u64 mask;
+            int shift;
+        public:
+            explicit flat_index_set(std::size_t expected)
+                : slots(std::bit_ceil(std::max<std::size_t>(expected * 2, 16)), EMPTY),
+                mask(slots.size() - 1),
+                shift(64 - std::countr_zero(slots.size())) {}
+
+            // returns false if value was already present
+            bool insert(u64 value) noexcept {
+                u64 i = (value * 0x9E3779B97F4A7C15ull) >> shift; //Fibonacci hashing
+                while(slots[i] != EMPTY){
+                    if(slots[i] == value){
+                        return false;
+                    }
+                    i = (i + 1) & mask;
+                }
+                slots[i] = value;
+                return true;
+            }
+        };
+
+        template<portable::full_range_engine G>
+        double uniform(G& g) noexcept {
+            return portable::uniform01_open(g);
+        }
+    }
+
+    // k distinct indices from [0, n), in the order they were picked. Requires k <= n.
+    template<portable::full_range_engine G>
+    std::vector<u64> floyd_sample(u64 n, u64 k, G& g) {
+        assert(k <= n && "sampling::floyd_sample: k must not exceed n.");
+        std::vector<u64> out;
+        out.reserve(static_cast<std::size_t>(k));
+        detail::flat_index_set seen(static_cast<std::size_t>(k));
+        for(u64 j = n - k; j < n; ++j){
+            const u64 t = portable::bounded(g, j + 1);
+            if(seen.insert(t)){
+                out.push_back(t);
+            } else { //t was already taken, but j can't have been
+                seen.insert(j);
+                out.push_back(j);
+            }
+        }
+        return out;
+    }
+
+    // Calls f(index) for k distinct indices from [0, n), in ascending order. Requires k <= n.
+    template<portable::full_range_engine G, typename F>
+    void for_each_sampled_index(u64 n, u64 k, G& g, F&& f) {
+        assert(k <= n && "sampling::for_each_sampled_index: k must not exceed n.");
+        using portable::exp;
+        using portable::log;
+        u64 current = 0;
+        const auto skip_and_select = [&](u64 skip){
+            current += skip;
+            f(current);
+            ++current;
+        };
+        if(k == 0){
+            return;
+        }
+        if(k == n){
+            for(u64 i = 0; i < n; ++i){ f(i); }
+            return;
+        }
+
+        //Method D, as published
+        constexpr u64 ALPHA_INV = 13; //switch to Method A once k >= n / 13
+        u64 N = n;
+        double Nreal = static_cast<double>(N);
+        double kreal = static_cast<double>(k);
+        double kinv = 1.0 / kreal;
+        double v_prime = exp(log(detail::uniform(g)) * kinv);
+        u64 qu1 = N - k + 1;
+        double qu1real = Nreal - kreal + 1.0;
+        u64 threshold = ALPHA_INV * k;
+        while(k > 1 && threshold < N){
+            const double kmin1inv = 1.0 / (kreal - 1.0);
+            u64 S;
+            while(true){
+                double X;
+                while(true){
+                    X = Nreal * (1.0 - v_prime);
+                    S = static_cast<u64>(X);
+                    if(S < qu1){ break; }
+                    v_prime = exp(log(detail::uniform(g)) * kinv);
+                }
+                const double y1 = exp(log(detail::uniform(g) * Nreal / qu1real) * kmin1inv);
+                v_prime = y1 * (1.0 - X / Nreal) * (qu1real / (qu1real - static_cast<double>(S)));
+                if(v_prime <= 1.0){
+                    break; //accepted by the squeeze
+                }
+                double y2 = 1.0;
+                double top = Nreal - 1.0;
+                double bottom;
+                u64 limit;
+                if(k - 1 > S){
+                    bottom = Nreal - kreal;
+                    limit = N - S;
+                } else {
+                    bottom = Nreal - static_cast<double>(S) - 1.0;
+                    limit = qu1;
+                }
+                for(u64 t = N - 1; t >= limit; --t){
+                    y2 = (y2 * top) / bottom;
+                    top -= 1.0;
+                    bottom -= 1.0;
+                }
+                if(Nreal / (Nreal - X) >= y1 * exp(log(y2) * kmin1inv)){
+                    v_prime = exp(log(detail::uniform(g)) * kmin1inv);
+                    break; //accepted by the full test
+                }
+                v_prime = exp(log(detail::uniform(g)) * kinv);
+            }
+            skip_and_select(S);
+            N -= S + 1;
+            Nreal -= static_cast<double>(S) + 1.0;
+            --k;
+            kreal -= 1.0;
+            kinv = kmin1inv;
+            qu1 -= S;
+            qu1real -= static_cast<double>(S);
+            threshold -= ALPHA_INV;
+        }
+        if(k == 1){
+            skip_and_select(portable::bounded(g, N));
+            return;
+        }
+
+        //Method A, for the dense remainder
+        u64 top = N - k;
+        Nreal = static_cast<double>(N);
+        while(k >= 2){
+            const double V = portable::uniform01(g);
+            u64 S = 0;
+            double quot = static_cast<double>(top) / Nreal;
+            while(quot > V){
+                ++S;
+                --top;
+                Nreal -= 1.0;
+                quot = quot * static_cast<double>(top) / Nreal;
+            }
+            skip_and_select(S);
+            Nreal -= 1.0;
+            --k;
+        }
+        skip_and_select(portable::bounded(g, static_cast<u64>(Nreal)));
+    }
+
+    // k distinct indices from [0, n), sorted ascending. Requires k <= n.
+    // Floyd's algorithm for small samples, Vitter's Algorithm D otherwise.
+    template<portable::full_range_engine G>
+    std::vector<u64> sample_indices(u64 n, u64 k, G& g) {
+        constexpr u64 FLOYD_MAX_K = 4096; //keeps the hash set in L1/L2
+        if(k <= FLOYD_MAX_K && k < n / 2){
+            auto out = floyd_sample(n, k, g);
+            std::sort(out.begin(), out.end());
+            return out;
+        }
+        std::vector<u64> out;
+        out.reserve(static_cast<std::size_t>(k));
+        for_each_sampled_index(n, k, g, [&](u64 i){ out.push_back(i); });
+        return out;
+    }
+
+    // Reservoir sampling, single pass over [first, last). Writes min(k, length) uniformly chosen
+    // elements to [out, out + k) (in no particular order) and returns the end of the written range.
+    template<std::input_iterator It, std::sentinel_for<It> S, std::random_access_iterator Out, portable::full_range_engine G>
+    Out reservoir_sample(It first, S last, Out out, std::size_t k, G& g) {
+        using portable::exp;
+        using portable::log;
+        std::size_t filled = 0;
+        for(; filled < k && first != last; ++first, ++filled){
+            out[filled] = *first;
+        }
+        if(filled < k || first == last){
+            return out + filled;
+        }
+        const double kinv = 1.0 / static_cast<double>(k);
+        double W = exp(log(detail::uniform(g)) * kinv);
+        while(true){
+            //geometric skip: number of items to pass over before the next replacement
+            const double skip = portable::floor(log(detail::uniform(g)) / portable::log1p(-W));
+            for(double i = 0.0; i < skip; i += 1.0){
+                ++first;
+                if(first == last){
+                    return out + k;
+                }
+            }
+            out[static_cast<std::size_t>(portable::bounded(g, k))] = *first;
+            ++first;
+            if(first == last){
+                return out + k;
+            }
+            W *= exp(log(detail::uniform(g)) * kinv);
+        }
+    }
+}
+PORTABLE_FP_END
+
+/* Example usage:
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "SmallFast_64.h"
+#include "sampling.hpp"
+
+int main() {
+    SmallFast64 rng(1234);
+
+    // 100 row ids out of 10 million, sorted
+    auto rows = sampling::sample_indices(10'000'000, 100, rng);
+
+    // stream a 1% sample of a billion-row table without materializing the indices
+    std::uint64_t sum = 0;
+    sampling::for_each_sampled_index(1'000'000'000, 10'000'000, rng, [&](auto row){ sum += row; });
+
+    // keep 1000 random lines from a stream of unknown length
+    std::vector<std::string> kept(1000);
+    auto end = sampling::reservoir_sample(std::istream_iterator<std::string>(std::cin), std::istream_iterator<std::string>(), kept.begin(), kept.size(), rng);
+    kept.erase(end, kept.end());
+    return static_cast<int>(rows.front() + sum);
+}
+*/
@@ -1,8 +1,19 @@
 #pragma once
+#include <bit>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <random>
+#include <span>
 #include <thread>
 #include <string_view>
+#if defined(__linux__) && __has_include(<sys/random.h>)
+#include <sys/random.h>
+#define SEED_HAS_GETRANDOM 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <stdlib.h>
+#define SEED_HAS_ARC4RANDOM 1
+#endif
 // Utility functions for seeding PRNGs (Pseudo Random Number Generators).
 // 
 // This file provides several approaches to generating high-quality seed values,
@@ -29,6 +40,13 @@ namespace seed {
         return x ^ (x >> 31);
     }
 
+    // Tag for engine constructors that fill their state straight from splitmix64 of the seed, with no
+    // warm-up rounds: SmallFast32(seed::mixed, 42). A different stream than the plain constructor.
+    struct mixed_t {
+        explicit mixed_t() = default;
+    };
+    inline constexpr mixed_t mixed{};
+
     // FNV1a for string hashing
     constexpr u64 fnv1a(std::string_view str) noexcept {
         u64 hash = 14695981039346656037ULL;
@@ -50,13 +68,19 @@ namespace seed {
 
     // Generate unique compile-time seeds even within the same compilation unit
     // Properties:
-    // - Different seed each time it's calle
+    // - Different seed at each call site of SEED_UNIQUE_FROM_SOURCE(), which passes the caller's
+    //   file and __COUNTER__ here (a function can't: __COUNTER__ would expand once, in this header)
     // - Useful for seeding multiple PRNGs at compile time
-#ifdef __COUNTER__
+    constexpr u64 unique_from_source(std::string_view file, u64 counter) noexcept {
+        return splitmix64(fnv1a(file) ^ from_source() ^ splitmix64(counter));
+    }
+
+    // The old zero-argument form, kept so existing callers still compile. It returns the same value
+    // at every call in a build: __COUNTER__ expands once, here. Use SEED_UNIQUE_FROM_SOURCE() instead.
+    [[deprecated("returns the same seed at every call, use SEED_UNIQUE_FROM_SOURCE()")]]
     constexpr u64 unique_from_source() noexcept {
-        return fnv1a(__FILE__ " " __DATE__ " " __TIME__ " " + std::to_string(__COUNTER__));
+        return fnv1a(__FILE__ ":" __DATE__ ":" __TIME__);
     }
-#endif
 
     // Wall clock time
     // Properties:
@@ -113,6 +137,37 @@ namespace seed {
         return splitmix64(entropy);
     }
 
+    // A whole block of operating system entropy, for seeding large states (std::mt19937's 2,496 bytes)
+    // Properties:
+    // - The kernel CSPRNG, the same source std::random_device reads on these platforms
+    // - One getrandom(2) call on Linux, arc4random_buf on macOS and the BSDs, instead of a
+    //   std::random_device call (and usually a syscall) per 32-bit word
+    // - Falls back to std::random_device elsewhere
+    inline void fill_entropy(std::span<u32> out) {
+#if defined(SEED_HAS_GETRANDOM)
+        auto* bytes = reinterpret_cast<unsigned char*>(out.data());
+        std::size_t left = out.size_bytes();
+        while (left > 0) { //more than 256 bytes can come back short if a signal interrupts the call
+            const auto got = getrandom(bytes, left, 0);
+            if (got <= 0) {
+                break;
+            }
+            bytes += got;
+            left -= static_cast<std::size_t>(got);
+        }
+        if (left == 0) {
+            return;
+        }
+#elif defined(SEED_HAS_ARC4RANDOM)
+        arc4random_buf(out.data(), out.size_bytes());
+        return;
+#endif
+        std::random_device rd;
+        for (auto& word : out) {
+            word = static_cast<u32>(rd());
+        }
+    }
+
     // Combines all available entropy sources
     // Properties:
     // - Maximum entropy mixing
@@ -134,11 +189,17 @@ namespace seed {
     }   
 }
 
+#ifdef __COUNTER__
+#define SEED_UNIQUE_FROM_SOURCE() (::seed::unique_from_source(__FILE__, __COUNTER__))
+#endif
+
 /* Example usage:
 
 // Compile-time seeding:
 constexpr auto seed1 = seed::fnv1a("my_game_seed");
 constexpr auto seed2 = seed::from_source();
+constexpr auto seed3 = SEED_UNIQUE_FROM_SOURCE(); // differs from seed4
+constexpr auto seed4 = SEED_UNIQUE_FROM_SOURCE();
 
 // Runtime seeding 
 SmallFast32 rng1(seed::to_32(seed::from_time())); // wall clock time
@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
+// small_dice<Engine>: unbiased rolls of small dice (d2 to d256) from a few bits each, instead of a
+// multiply and rejection check on a whole engine word per roll.
+//
+// roll<Sides>() takes a W-bit chunk from a 64-bit buffer of engine output and maps it through a
+// table built at compile time for that die: entry c is (c * Sides) >> W, Lemire's multiply-shift,
+// or a reject mark for the 2^W mod Sides chunks that would bias it. W is chosen per die to balance
+// bits spent against mispredicted rejections: 2 bits for a d4, 7 for a d6 (1 chunk in 64 rejected),
+// 8 for a d12, so one 64-bit engine step gives 32 d4s or 9 d6s. Dice that need more than 8 bits to
+// keep rejection rare (d20, d100) use the multiply-shift directly on 9 to 16-bit chunks.
+//
+// roll<Sides>(span out) is the bulk mode: the engine fills a block of words, which are split into
+// 8 or 16-bit lanes, and every lane is mapped with the multiply-shift in a loop the compiler
+// vectorizes (16-bit multiplies, SSE2 has them). Where Sides^2 fits, a 16-bit lane gives two rolls
+// from one multiply chain, as SmallFast64::next_2 does: a d6 lane rejects 1 in 4096 and a d20 lane 1
+// in 195, where an 8-bit d20 lane would reject 1 in 16. Rejected lanes are marked in the same loop
+// and only those are rolled again, one by one. The table is for the scalar path: a 256-entry lookup
+// doesn't vectorize without AVX-512 VBMI (vpermb), and the multiply is as cheap.
+//
+// Both modes are deterministic, but the bulk mode consumes the engine differently, so its rolls are
+// not the same as a loop of roll<Sides>(). Values are 0-based, [0, Sides), as next(bound).
+namespace dice_detail {
+    using u32 = std::uint32_t;
+
+    // a rejected chunk costs a mispredicted branch, about as long as drawing 64 more bits
+    inline constexpr double REJECT_COST_BITS = 64.0;
+    // in the bulk mode a rejected lane is rolled again by the scalar path, as long as ~1000 bits in bulk
+    inline constexpr double BULK_REJECT_COST_BITS = 1024.0;
+
+    // the chunk width with the lowest expected cost per accepted roll
+    constexpr u32 chunk_bits(u32 sides) noexcept {
+        u32 best = 16;
+        double best_cost = 1e300;
+        for(u32 w = 1; w <= 16; ++w){
+            if((u32(1) << w) < sides){
+                continue;
+            }
+            const double reject = static_cast<double>((u32(1) << w) % sides) / static_cast<double>(u32(1) << w);
+            const double cost = (w + reject * REJECT_COST_BITS) / (1.0 - reject);
+            if(cost < best_cost){
+                best = w;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    // bulk lanes: 8-bit with one roll each, or 16-bit with one or two (Sides^2 still fits the multiply)
+    struct bulk_plan {
+        u32 lane_bits;
+        u32 rolls;
+    };
+
+    constexpr bulk_plan plan(u32 sides) noexcept {
+        constexpr std::array<bulk_plan, 3> PLANS{{{8, 1}, {16, 1}, {16, 2}}};
+        bulk_plan best = PLANS[1];
+        double best_cost = 1e300;
+        for(const bulk_plan p : PLANS){
+            const u32 range = p.rolls == 2 ? sides * sides : sides;
+            if(range > (u32(1) << p.lane_bits) || (p.rolls == 2 && sides > 255)){
+                continue;
+            }
+            const double reject = static_cast<double>((u32(1) << p.lane_bits) % range) / static_cast<double>(u32(1) << p.lane_bits);
+            const double cost = static_cast<double>(p.lane_bits) / p.rolls + reject * BULK_REJECT_COST_BITS;
+            if(cost < best_cost){
+                best = p;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    inline constexpr std::uint8_t REJECT = 0xFF; //no die below 256 sides has it as a value
+
+    template<u32 Sides, u32 W>
+    inline constexpr auto TABLE = []{
+        std::array<std::uint8_t, (std::size_t(1) << W)> table{};
+        const u32 reject_below = (u32(1) << W) % Sides;
+        for(u32 c = 0; c < table.size(); ++c){
+            const u32 m = c * Sides;
+            table[c] = ((m & ((u32(1) << W) - 1)) < reject_below) ? REJECT : static_cast<std::uint8_t>(m >> W);
+        }
+        return table;
+    }();
+}
+
+template<portable::full_range_engine Engine>
+class small_dice {
+public:
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    template<typename... Args>
+        requires std::is_constructible_v<Engine, Args...>
+    constexpr explicit small_dice(Args&&... args) noexcept(std::is_nothrow_constructible_v<Engine, Args...>)
+        : engine_(std::forward<Args>(args)...) {}
+
+    // [0, Sides)
+    template<u32 Sides>
+        requires (Sides >= 2 && Sides <= 256)
+    constexpr std::uint8_t roll() noexcept {
+        constexpr u32 W = dice_detail::chunk_bits(Sides);
+        while(true){
+            const u32 c = take(W);
+            if constexpr((Sides & (Sides - 1)) == 0){
+                return static_cast<std::uint8_t>(c); //W = log2(Sides), never rejected
+            } else if constexpr(W <= 8){
+                const std::uint8_t v = dice_detail::TABLE<Sides, W>[c];
+                if(v != dice_detail::REJECT){
+                    return v;
+                }
+            } else {
+                const u32 m = c * Sides;
+                if((m & ((u32(1) << W) - 1)) >= (u32(1) << W) % Sides){
+                    return static_cast<std::uint8_t>(m >> W);
+                }
+            }
+        }
+    }
+
+    // out.size() rolls in [0, Sides), vectorized
+    template<u32 Sides>
+        requires (Sides >= 2 && Sides <= 256)
+    void roll(std::span<std::uint8_t> out) noexcept {
+        constexpr dice_detail::bulk_plan PLAN = dice_detail::plan(Sides);
+        using lane = std::conditional_t<PLAN.lane_bits == 8, std::uint8_t, std::uint16_t>;
+        constexpr u32 REJECT_BELOW = (u32(1) << PLAN.lane_bits) % (PLAN.rolls == 2 ? Sides * Sides : Sides);
+        constexpr std::size_t PER_WORD = 8 / sizeof(lane);
+        constexpr std::size_t LANES = BLOCK_WORDS * PER_WORD;
+        std::array<u64, BLOCK_WORDS> words{}; //a partial block draws fewer words, the lane loop reads them all
+        std::array<lane, LANES> chunks;
+        std::array<std::uint8_t, LANES * PLAN.rolls> values; //lane i rolls values[i] and values[LANES + i]
+        for(std::size_t first = 0; first < out.size(); first += values.size()){
+            const std::size_t n = std::min(out.size() - first, values.size());
+            draw(words, (std::min(n, LANES) + PER_WORD - 1) / PER_WORD);
+            if constexpr(std::endian::native == std::endian::little){
+                std::memcpy(chunks.data(), words.data(), sizeof(words));
+            } else {
+                for(std::size_t w = 0; w < BLOCK_WORDS; ++w){ //the same lanes as the little-endian copy
+                    for(std::size_t j = 0; j < PER_WORD; ++j){
+                        chunks[w * PER_WORD + j] = static_cast<lane>(words[w] >> (j * PLAN.lane_bits));
+                    }
+                }
+            }
+            lane any = 0;
+            for(std::size_t i = 0; i < LANES; ++i){ //the whole block, a fixed trip count needs no scalar tail
+                // the digits of (chunk * Sides^rolls) >> lane_bits, as in SmallFast64::next_2
+                u32 m = u32(chunks[i]) * Sides;
+                const auto first_roll = static_cast<std::uint8_t>(m >> PLAN.lane_bits);
+                std::uint8_t second_roll = 0;
+                if constexpr(PLAN.rolls == 2){
+                    m = u32(static_cast<lane>(m)) * Sides;
+                    second_roll = static_cast<std::uint8_t>(m >> PLAN.lane_bits);
+                }
+                const bool reject = REJECT_BELOW != 0 && static_cast<lane>(m) < REJECT_BELOW;
+                any |= static_cast<lane>(reject);
+                values[i] = reject ? dice_detail::REJECT : first_roll;
+                if constexpr(PLAN.rolls == 2){
+                    values[LANES + i] = reject ? dice_detail::REJECT : second_roll;
+                }
+            }
+            if constexpr(REJECT_BELOW != 0){
+                for(std::size_t i = 0; any != 0 && i < n; i += 8){
+                    u64 x;
+                    std::memcpy(&x, values.data() + i, 8);
+                    // the high bit of each REJECT byte; no carries between bytes, so no false positives
+                    const u64 y = ~x;
+                    u64 marks = ~(((y & 0x7F7F7F7F7F7F7F7F) + 0x7F7F7F7F7F7F7F7F) | y | 0x7F7F7F7F7F7F7F7F);
+                    while(marks != 0){
+                        const auto byte = static_cast<std::size_t>(std::countr_zero(marks) / 8);
+                        const std::size_t j = i + (std::endian::native == std::endian::little ? byte : 7 - byte);
+                        if(j < n){
+                            values[j] = roll<Sides>();
+                        }
+                        marks &= marks - 1;
+                    }
+                }
+            }
+            std::copy_n(values.data(), n, out.data() + first);
+        }
+    }
+
+    constexpr Engine& engine() noexcept { return engine_; }
+    constexpr const Engine& engine() const noexcept { return engine_; }
+
+    constexpr bool operator==(const small_dice&) const noexcept = default;
+
+private:
+    static constexpr std::size_t BLOCK_WORDS = 128;
+
+    Engine engine_;
+    u64 bits_ = 0;  //unused bits at the top
+    u32 left_ = 0;
+
+    // the next n bits, n <= 16. The few bits left over when a chunk doesn't fit are dropped.
+    constexpr u32 take(u32 n) noexcept {
+        if(left_ < n){
+            bits_ = portable::bits64(engine_);
+            left_ = 64;
+        }
+        const auto v = static_cast<u32>(bits_ >> (64 - n));
+        bits_ <<= n;
+        left_ -= n;
+        return v;
+    }
+
+    // count words of engine output into the front of words, the rest keep stale values
+    void draw(std::array<u64, BLOCK_WORDS>& words, std::size_t count) noexcept {
+        if constexpr(Engine::max() == std::numeric_limits<u64>::max()){
+            engine_.fill(std::span<u64>(words.data(), count));
+        } else {
+            Engine copy = engine_; //see engine_interface::fill
+            for(std::size_t w = 0; w < count; ++w){
+                words[w] = portable::bits64(copy);
+            }
+            engine_ = copy;
+        }
+    }
+};
+
+/* Example usage:
+#include <vector>
+#include "small_dice.hpp"
+#include "SmallFast_64.h"
+
+int main() {
+    small_dice<SmallFast64> dice(42);
+    int attack = dice.roll<20>() + 1;               //[1, 20], 6 per engine step
+    int damage = dice.roll<6>() + dice.roll<6>() + 2; //7-bit chunks and a table lookup
+    int percentile = dice.roll<100>();              //[0, 100)
+
+    // a million d6 for a Monte Carlo balance check, vectorized
+    std::vector<std::uint8_t> rolls(1'000'000);
+    dice.roll<6>(rolls);
+    return attack + damage + percentile + rolls[0];
+}
+*/
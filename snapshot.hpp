@@ -0,0 +1,481 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "PCG32.hpp"
+#include "RomuQuad.hpp"
+#include "RomuTrio.hpp"
+#include "SFC64.hpp"
+#include "SmallFast_32.h"
+#include "SmallFast_64.h"
+#include "WyRand.hpp"
+#include "xoshiro256ss.h"
+// Binary snapshots of (many) generator states, for checkpoints and save games.
+//
+// Layout, all integers little-endian regardless of host:
+//   [0, 64)   header: "PRNGSNAP", version, engine tag, word size, words per state, kind, count
+//   full snapshot:  [64, ...) the states, one after another, count * words per state words
+//   delta snapshot: [64, ...) count u64 indices, padded to a multiple of 64 bytes, then their states
+//
+// The state array starts 64 bytes in, so a page-aligned mmap of the file gives a cache-line aligned,
+// contiguous array. view<Engine> reads generators straight out of such a mapping (or any other
+// byte buffer) with no parsing pass: on little-endian hosts each access is a plain load. Writing is
+// a straight loop over get_state(), so saving 10M SmallFast32 is about as fast as a 160MB memcpy.
+//
+// Incremental checkpoints: save_delta() compares the current generators to the previous snapshot and
+// only stores the ones that moved. apply_delta() patches them into a mutable_view, eg. a MAP_SHARED
+// mapping of the full snapshot file.
+//
+// Add support for your own engine by specializing snapshot::traits.
+namespace snapshot {
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+
+    inline constexpr std::string_view MAGIC = "PRNGSNAP";
+    inline constexpr u32 VERSION = 1;
+    inline constexpr std::size_t HEADER_SIZE = 64;
+
+    enum class kind : u32 { full = 0, delta = 1 };
+
+    constexpr u32 fourcc(const char (&s)[5]) noexcept {
+        return u32(u32(std::uint8_t(s[0])) | u32(std::uint8_t(s[1])) << 8 | u32(std::uint8_t(s[2])) << 16 | u32(std::uint8_t(s[3])) << 24);
+    }
+
+    // Describes how an engine's state maps to words. Specialize for your own engines:
+    //   tag   - a unique fourcc, stored in the header and checked on load
+    //   word  - u32 or u64
+    //   WORDS - words per state
+    //   store(engine, words*) / load(const words*)
+    template<typename Engine>
+    struct traits;
+
+    template<>
+    struct traits<SmallFast32> {
+        static constexpr u32 tag = fourcc("SF32");
+        using word = u32;
+        static constexpr std::size_t WORDS = 4;
+        static constexpr void store(const SmallFast32& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr SmallFast32 load(const word* in) noexcept {
+            return SmallFast32(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<SmallFast64> {
+        static constexpr u32 tag = fourcc("SF64");
+        using word = u64;
+        static constexpr std::size_t WORDS = 4;
+        static constexpr void store(const SmallFast64& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr SmallFast64 load(const word* in) noexcept {
+            return SmallFast64(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<PCG32> {
+        static constexpr u32 tag = fourcc("PC32");
+        using word = u64;
+        static constexpr std::size_t WORDS = 2;
+        static constexpr void store(const PCG32& e, word* out) noexcept {
+            const auto [state, inc] = e.get_state();
+            out[0] = state;
+            out[1] = inc;
+        }
+        static constexpr PCG32 load(const word* in) noexcept {
+            return PCG32::from_state(in[0], in[1]);
+        }
+    };
+
+    // every xoshiro variant, RNG (xoshiro256**) keeps its original tag
+    template<std::size_t Bits, xoshiro::scrambler Scrambler>
+    struct traits<Xoshiro<Bits, Scrambler>> {
+        using engine = Xoshiro<Bits, Scrambler>;
+        static constexpr u32 tag = Bits == 256
+            ? (Scrambler == xoshiro::scrambler::star_star ? fourcc("X256") : Scrambler == xoshiro::scrambler::plus_plus ? fourcc("X2++") : fourcc("X25+"))
+            : (Scrambler == xoshiro::scrambler::star_star ? fourcc("X128") : Scrambler == xoshiro::scrambler::plus_plus ? fourcc("X1++") : fourcc("X12+"));
+        using word = typename engine::word;
+        static constexpr std::size_t WORDS = engine::SEED_COUNT;
+        static constexpr void store(const engine& e, word* out) noexcept {
+            const auto s = e.state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr engine load(const word* in) noexcept {
+            return engine(typename engine::Span(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<RomuTrio> {
+        static constexpr u32 tag = fourcc("RMT3");
+        using word = u64;
+        static constexpr std::size_t WORDS = 3;
+        static constexpr void store(const RomuTrio& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr RomuTrio load(const word* in) noexcept {
+            return RomuTrio(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<RomuQuad> {
+        static constexpr u32 tag = fourcc("RMQ4");
+        using word = u64;
+        static constexpr std::size_t WORDS = 4;
+        static constexpr void store(const RomuQuad& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr RomuQuad load(const word* in) noexcept {
+            return RomuQuad(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<WyRand> {
+        static constexpr u32 tag = fourcc("WYRD");
+        using word = u64;
+        static constexpr std::size_t WORDS = 1;
+        static constexpr void store(const WyRand& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr WyRand load(const word* in) noexcept {
+            return WyRand(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    template<>
+    struct traits<SFC64> {
+        static constexpr u32 tag = fourcc("SFC6");
+        using word = u64;
+        static constexpr std::size_t WORDS = 4;
+        static constexpr void store(const SFC64& e, word* out) noexcept {
+            const auto s = e.get_state();
+            for(std::size_t i = 0; i < WORDS; ++i){ out[i] = s[i]; }
+        }
+        static constexpr SFC64 load(const word* in) noexcept {
+            return SFC64(std::span<const word, WORDS>(in, WORDS));
+        }
+    };
+
+    namespace detail {
+        template<typename W>
+        inline W load_le(const std::byte* p) noexcept {
+            W w;
+            std::memcpy(&w, p, sizeof(W));
+            if constexpr(std::endian::native == std::endian::big){
+                W swapped = 0;
+                for(std::size_t i = 0; i < sizeof(W); ++i){
+                    swapped = static_cast<W>((swapped << 8) | ((w >> (8 * i)) & 0xFF));
+                }
+                w = swapped;
+            }
+            return w;
+        }
+
+        template<typename W>
+        inline void store_le(std::byte* p, W w) noexcept {
+            if constexpr(std::endian::native == std::endian::big){
+                for(std::size_t i = 0; i < sizeof(W); ++i){
+                    p[i] = static_cast<std::byte>((w >> (8 * i)) & 0xFF);
+                }
+            } else {
+                std::memcpy(p, &w, sizeof(W));
+            }
+        }
+
+        constexpr std::size_t round_up(std::size_t n, std::size_t multiple) noexcept {
+            return (n + multiple - 1) / multiple * multiple;
+        }
+
+        template<typename Engine>
+        constexpr std::size_t state_bytes() noexcept {
+            return traits<Engine>::WORDS * sizeof(typename traits<Engine>::word);
+        }
+
+        // the index table of a delta, padded to whole cache lines. Only for counts that fit a buffer
+        constexpr std::size_t index_bytes(u64 count) noexcept {
+            return round_up(static_cast<std::size_t>(count) * sizeof(u64), HEADER_SIZE);
+        }
+
+        template<typename Engine>
+        inline void write_header(std::byte* out, kind k, u64 count) noexcept {
+            std::fill_n(out, HEADER_SIZE, std::byte{0});
+            std::memcpy(out, MAGIC.data(), MAGIC.size());
+            store_le<u32>(out + 8, VERSION);
+            store_le<u32>(out + 12, traits<Engine>::tag);
+            store_le<u32>(out + 16, static_cast<u32>(sizeof(typename traits<Engine>::word)));
+            store_le<u32>(out + 20, static_cast<u32>(traits<Engine>::WORDS));
+            store_le<u32>(out + 24, static_cast<u32>(k));
+            store_le<u64>(out + 32, count);
+        }
+
+        // validates the header against Engine and the buffer size. Returns the state count.
+        template<typename Engine>
+        inline std::optional<u64> read_header(std::span<const std::byte> bytes, kind expected) noexcept {
+            if(bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC.data(), MAGIC.size()) != 0){
+                return std::nullopt;
+            }
+            const std::byte* p = bytes.data();
+            if(load_le<u32>(p + 8) != VERSION
+                || load_le<u32>(p + 12) != traits<Engine>::tag
+                || load_le<u32>(p + 16) != sizeof(typename traits<Engine>::word)
+                || load_le<u32>(p + 20) != traits<Engine>::WORDS
+                || load_le<u32>(p + 24) != static_cast<u32>(expected)){
+                return std::nullopt;
+            }
+            // count comes from the file: check it by division, count * entry size can wrap
+            const u64 count = load_le<u64>(p + 32);
+            u64 left = bytes.size() - HEADER_SIZE;
+            if(expected == kind::delta){
+                if(count > left / sizeof(u64) || index_bytes(count) > left){
+                    return std::nullopt;
+                }
+                left -= index_bytes(count);
+            }
+            if(count > left / state_bytes<Engine>()){
+                return std::nullopt;
+            }
+            return count;
+        }
+
+        template<typename Engine>
+        inline void write_state(std::byte* out, const Engine& e) noexcept {
+            using word = typename traits<Engine>::word;
+            std::array<word, traits<Engine>::WORDS> words{};
+            traits<Engine>::store(e, words.data());
+            for(std::size_t w = 0; w < words.size(); ++w){
+                store_le<word>(out + w * sizeof(word), words[w]);
+            }
+        }
+
+        template<typename Engine>
+        inline Engine read_state(const std::byte* in) noexcept {
+            using word = typename traits<Engine>::word;
+            std::array<word, traits<Engine>::WORDS> words{};
+            for(std::size_t w = 0; w < words.size(); ++w){
+                words[w] = load_le<word>(in + w * sizeof(word));
+            }
+            return traits<Engine>::load(words.data());
+        }
+    }
+
+    // bytes needed for a full snapshot of count generators
+    template<typename Engine>
+    constexpr std::size_t size(std::size_t count) noexcept {
+        return HEADER_SIZE + count * detail::state_bytes<Engine>();
+    }
+
+    // Writes a full snapshot into out, which must hold at least size<Engine>(engines.size()) bytes.
+    template<typename Engine>
+    void write(std::span<const Engine> engines, std::span<std::byte> out) noexcept {
+        assert(out.size() >= size<Engine>(engines.size()) && "snapshot::write: output buffer too small.");
+        detail::write_header<Engine>(out.data(), kind::full, engines.size());
+        std::byte* p = out.data() + HEADER_SIZE;
+        for(const auto& e : engines){
+            detail::write_state(p, e);
+            p += detail::state_bytes<Engine>();
+        }
+    }
+
+    template<typename Engine>
+    std::vector<std::byte> save(std::span<const Engine> engines) {
+        std::vector<std::byte> out(size<Engine>(engines.size()));
+        write(engines, std::span<std::byte>(out));
+        return out;
+    }
+
+    template<typename Engine>
+    bool save(const char* path, std::span<const Engine> engines) {
+        const auto bytes = save(engines);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    }
+
+    // Read-only view of a full snapshot, eg. a read-only mmap of a snapshot file. Does not own the
+    // bytes. Generators are built on access straight from the mapped words.
+    template<typename Engine>
+    class view {
+    public:
+        // nullopt if the bytes aren't a full snapshot of Engine (wrong magic, version, tag, or truncated)
+        static std::optional<view> open(std::span<const std::byte> bytes) noexcept {
+            const auto count = detail::read_header<Engine>(bytes, kind::full);
+            if(!count){
+                return std::nullopt;
+            }
+            return view(bytes.data() + HEADER_SIZE, static_cast<std::size_t>(*count));
+        }
+
+        std::size_t size() const noexcept { return count_; }
+
+        Engine operator[](std::size_t i) const noexcept {
+            assert(i < count_);
+            return detail::read_state<Engine>(states_ + i * detail::state_bytes<Engine>());
+        }
+
+        void load(std::span<Engine> out) const noexcept {
+            assert(out.size() <= count_);
+            for(std::size_t i = 0; i < out.size(); ++i){
+                out[i] = (*this)[i];
+            }
+        }
+
+        std::vector<Engine> load() const {
+            std::vector<Engine> out;
+            out.reserve(count_);
+            for(std::size_t i = 0; i < count_; ++i){
+                out.push_back((*this)[i]);
+            }
+            return out;
+        }
+
+        // true if engine i differs from e
+        bool changed(std::size_t i, const Engine& e) const noexcept {
+            std::array<std::byte, detail::state_bytes<Engine>()> current{};
+            detail::write_state(current.data(), e);
+            return std::memcmp(current.data(), states_ + i * current.size(), current.size()) != 0;
+        }
+
+    protected:
+        view(const std::byte* states, std::size_t count) noexcept : states_(states), count_(count) {}
+        const std::byte* states_;
+        std::size_t count_;
+    };
+
+    // Writable view of a full snapshot, eg. a MAP_SHARED mmap of a snapshot file. Lets you update
+    // generators in place and apply deltas without rewriting the file.
+    template<typename Engine>
+    class mutable_view : public view<Engine> {
+    public:
+        static std::optional<mutable_view> open(std::span<std::byte> bytes) noexcept {
+            const auto count = detail::read_header<Engine>(bytes, kind::full);
+            if(!count){
+                return std::nullopt;
+            }
+            return mutable_view(bytes.data() + HEADER_SIZE, static_cast<std::size_t>(*count));
+        }
+
+        void store(std::size_t i, const Engine& e) noexcept {
+            assert(i < this->count_);
+            detail::write_state(data_ + i * detail::state_bytes<Engine>(), e);
+        }
+
+    private:
+        mutable_view(std::byte* states, std::size_t count) noexcept : view<Engine>(states, count), data_(states) {}
+        std::byte* data_;
+    };
+
+    // Delta snapshot: only the generators that differ from previous. current may be longer than
+    // previous, new generators are always included.
+    template<typename Engine>
+    std::vector<std::byte> save_delta(std::span<const Engine> current, const view<Engine>& previous) {
+        std::vector<u64> changed;
+        for(std::size_t i = 0; i < current.size(); ++i){
+            if(i >= previous.size() || previous.changed(i, current[i])){
+                changed.push_back(i);
+            }
+        }
+        const std::size_t index_bytes = detail::index_bytes(changed.size());
+        std::vector<std::byte> out(HEADER_SIZE + index_bytes + changed.size() * detail::state_bytes<Engine>());
+        detail::write_header<Engine>(out.data(), kind::delta, changed.size());
+        std::byte* indices = out.data() + HEADER_SIZE;
+        std::byte* states = indices + index_bytes;
+        for(std::size_t c = 0; c < changed.size(); ++c){
+            detail::store_le<u64>(indices + c * sizeof(u64), changed[c]);
+            detail::write_state(states + c * detail::state_bytes<Engine>(), current[static_cast<std::size_t>(changed[c])]);
+        }
+        return out;
+    }
+
+    // Applies a delta to a full snapshot in place. Returns false (and changes nothing) if the delta is
+    // malformed, for another engine, or refers to generators beyond the end of target.
+    template<typename Engine>
+    bool apply_delta(std::span<const std::byte> delta, mutable_view<Engine>& target) noexcept {
+        const auto count = detail::read_header<Engine>(delta, kind::delta);
+        if(!count){
+            return false;
+        }
+        const std::byte* indices = delta.data() + HEADER_SIZE;
+        const std::byte* states = indices + detail::index_bytes(*count); //read_header checked it fits delta
+        for(u64 c = 0; c < *count; ++c){
+            if(detail::load_le<u64>(indices + c * sizeof(u64)) >= target.size()){
+                return false;
+            }
+        }
+        for(u64 c = 0; c < *count; ++c){
+            const auto i = static_cast<std::size_t>(detail::load_le<u64>(indices + c * sizeof(u64)));
+            target.store(i, detail::read_state<Engine>(states + c * detail::state_bytes<Engine>()));
+        }
+        return true;
+    }
+
+    // Applies a delta to generators in memory. Same validation as above.
+    template<typename Engine>
+    bool apply_delta(std::span<const std::byte> delta, std::span<Engine> target) noexcept {
+        const auto count = detail::read_header<Engine>(delta, kind::delta);
+        if(!count){
+            return false;
+        }
+        const std::byte* indices = delta.data() + HEADER_SIZE;
+        const std::byte* states = indices + detail::index_bytes(*count); //read_header checked it fits delta
+        for(u64 c = 0; c < *count; ++c){
+            if(detail::load_le<u64>(indices + c * sizeof(u64)) >= target.size()){
+                return false;
+            }
+        }
+        for(u64 c = 0; c < *count; ++c){
+            const auto i = static_cast<std::size_t>(detail::load_le<u64>(indices + c * sizeof(u64)));
+            target[i] = detail::read_state<Engine>(states + c * detail::state_bytes<Engine>());
+        }
+        return true;
+    }
+}
+
+/* Example usage:
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "snapshot.hpp"
+
+int main() {
+    std::vector<SmallFast32> entities(10'000'000);
+    snapshot::save<SmallFast32>("world.snap", entities);         // full checkpoint
+
+    // ... simulate a tick, some entities draw numbers ...
+    entities[42].next();
+
+    // map the last full checkpoint and write only what changed
+    int fd = open("world.snap", O_RDWR);
+    const auto bytes = snapshot::size<SmallFast32>(entities.size());
+    auto* base = static_cast<std::byte*>(mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    auto checkpoint = snapshot::mutable_view<SmallFast32>::open({base, bytes});
+    auto delta = snapshot::save_delta<SmallFast32>(entities, *checkpoint); // 1 state + 128 bytes of headers
+
+    // roll the file forward, no rewrite
+    snapshot::apply_delta<SmallFast32>(delta, *checkpoint);
+
+    // restore a single entity's generator straight from the mapping
+    SmallFast32 restored = (*checkpoint)[42];
+    munmap(base, bytes);
+    close(fd);
+    return restored == entities[42] ? 0 : 1;
+}
+*/
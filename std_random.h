@@ -1,42 +1,104 @@
+#pragma once
 /*
 A demonstration of using the C++ standard library features to generate random numbers.
+
+BasicRandom<Engine> works with std::mt19937 (Random) and std::mt19937_64 (Random64). The 64-bit engine
+has the same 2,496 byte state, but gives 64 bits per step, so 64-bit getNumber ranges cost one draw.
 */
 #include <random>
 #include <type_traits>
 #include <array>
+#include <cstdint>
 #include <span>
+#include "seed.hpp"
+
+// A SeedSequence that copies its words into the engine's state as they are. std::seed_seq runs
+// several passes of mixing over its whole buffer, which only matters for seeds with little entropy
+// in them; a block of OS entropy, or the mixed output of another generator, can go straight in.
+// Only generate() is used by the standard engines, so that is all this provides besides size() and
+// param(). It refers to the words rather than owning them: keep them alive while seeding.
+class state_seed_seq {
+public:
+    using result_type = std::uint32_t;
+
+    explicit state_seed_seq(std::span<const result_type> words) noexcept : words_(words) {}
+
+    template<typename It>
+    void generate(It first, It last) const {
+        for (std::size_t i = 0; first != last; ++first, ++i) {
+            *first = (i < words_.size()) ? words_[i] : 0;
+        }
+    }
+
+    std::size_t size() const noexcept { return words_.size(); }
 
-class Random {
+    template<typename It>
+    void param(It out) const {
+        for (auto w : words_) { *out++ = w; }
+    }
+
+private:
+    std::span<const result_type> words_;
+};
+
+template<typename Engine>
+class BasicRandom {
 private:
-    std::mt19937 rng_;
-    
-    static auto generate_seed_sequence() {        
-        // we need 624 32-bit words to fully initialize MT19937's state
-        std::array<std::random_device::result_type, std::mt19937::state_size> entropy_array;        
-        std::random_device rd{};
-        for (auto& value : entropy_array) {
-            value = rd();
-        }        
-        return std::seed_seq(entropy_array.begin(), entropy_array.end());
+    static_assert(Engine::word_size == 32 || Engine::word_size == 64, "BasicRandom needs a Mersenne Twister, std::mt19937 or std::mt19937_64.");
+    // 32-bit words to fill the full state, what the engine asks a SeedSequence for: 624 either way
+    static constexpr std::size_t STATE_WORDS = Engine::state_size * (Engine::word_size / 32);
+    using state_words = std::array<std::uint32_t, STATE_WORDS>;
+
+    Engine rng_;
+
+    static Engine from_entropy() {
+        state_words entropy;
+        seed::fill_entropy(entropy); //one syscall for the full state
+        state_seed_seq seq(entropy);
+        return Engine(seq);
     }
 
-public:        
-    explicit Random(std::seed_seq seed_seq) : rng_(seed_seq) {}
+    explicit BasicRandom(Engine rng) : rng_(rng) {}
+
+public:
+    explicit BasicRandom(std::seed_seq seed_seq) : rng_(seed_seq) {}
 
     //default ctor fully seeds the generator
-    Random() : Random(generate_seed_sequence()) {}
+    BasicRandom() : rng_(from_entropy()) {}
 
     //custom ctors support manual seeding for reproducibility
-    explicit Random(std::uint64_t seed) 
-        : Random(std::seed_seq{seed}) {}        
-    explicit Random(std::span<const std::uint64_t> seed_data) 
-        : Random(std::seed_seq(seed_data.begin(), seed_data.end())) {}
-    
+    explicit BasicRandom(std::uint64_t seed)
+        : BasicRandom(std::seed_seq{seed}) {}
+    explicit BasicRandom(std::span<const std::uint64_t> seed_data)
+        : BasicRandom(std::seed_seq(seed_data.begin(), seed_data.end())) {}
+
     void randomize() {
-        auto seed_seq = generate_seed_sequence();
-        rng_.seed(seed_seq);
+        rng_ = from_entropy();
+    }
+
+    // A new generator with a full, independent state, without asking the OS: 128 bits of our output
+    // as a key, expanded to the whole state through splitmix64. The key makes clones distinct (two
+    // equal ones are a 2^-128 event), and the splitmix64 multiplies keep the child from being a
+    // linear function of our stream, as MT output copied straight into a state would be. We advance
+    // by 128 bits only, a few microseconds per clone, most of it the child's first twist.
+    BasicRandom clone_independent() {
+        std::uint64_t key[2];
+        for (auto& k : key) {
+            k = rng_();
+            if constexpr (Engine::word_size == 32) {
+                k = (k << 32) | rng_();
+            }
+        }
+        state_words words;
+        for (std::size_t i = 0; i < STATE_WORDS; i += 2) {
+            const std::uint64_t bits = seed::splitmix64(seed::splitmix64(key[0] + i) ^ key[1]);
+            words[i] = static_cast<std::uint32_t>(bits);
+            words[i + 1] = static_cast<std::uint32_t>(bits >> 32);
+        }
+        state_seed_seq seq(words);
+        return BasicRandom(Engine(seq));
     }
-    
+
     unsigned char color() {  // 0-255 inclusive
         std::uniform_int_distribution<int> dist{0, 255};
         return static_cast<unsigned char>(dist(rng_));
@@ -56,13 +118,13 @@ public:
         std::uniform_real_distribution<float> dist{-1.0, 1.0};
         return dist(rng_);
     }
-    
+
     template<typename T>
-    T getNumber(T min, T max) {  
-        if constexpr (std::is_integral_v<T>) {           
+    T getNumber(T min, T max) {
+        if constexpr (std::is_integral_v<T>) {
             std::uniform_int_distribution<T> dist{min, max};
             return dist(rng_);
-        } else if constexpr (std::is_floating_point_v<T>) {            
+        } else if constexpr (std::is_floating_point_v<T>) {
             std::uniform_real_distribution<T> dist{min, max};
             return dist(rng_);
         } else {
@@ -72,10 +134,13 @@ public:
     }
 };
 
+using Random = BasicRandom<std::mt19937>;
+using Random64 = BasicRandom<std::mt19937_64>;
+
 /* usage
 int main(){
     Random rng;
-    
+
     // Integer ranges (inclusive)
     int i = rng.getNumber(1, 6);
     short s = rng.getNumber<short>(0, 100);
@@ -90,6 +155,13 @@ int main(){
     auto coin = rng.coinToss();            // true/false
     auto norm = rng.normalized();          // [0.0,1.0)
     auto unit = rng.unit_range();          // [-1.0,1.0]
-    return s;
+
+    // 64-bit engine: one draw per 64-bit number
+    Random64 rng64;
+    std::uint64_t id = rng64.getNumber<std::uint64_t>(0, ~0ull);
+
+    // one generator per match, no OS calls: a full state derived from the first generator
+    Random match_rng = rng.clone_independent();
+    return s + match_rng.getNumber(1, 6) + static_cast<int>(id & 1);
 }
 */
@@ -1,135 +1,192 @@
+#pragma once
+#include <algorithm>
 #include <array>
-#include <bitset>
 #include <cassert>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <span>
 #include <type_traits>
+#include "engine_interface.hpp"
+#include "portable_math.hpp"
 
-// The "xoshiro256** 1.0" generator.
-// Public interface, rejection sampling and seeding utilities (see; Seeding.h) 
+// The xoshiro family: "xoshiro256** 1.0" (RNG) and its siblings, selected at compile time.
+// Public interface, rejection sampling and seeding utilities (see; Seeding.h)
 // by Ulf Benjaminsson (2023)
 // https://ulfbenjaminsson.com/
 // Based on C++ port by Arthur O'Dwyer (2021).
 // https://quuxplusone.github.io/blog/2021/11/23/xoshiro/
-// of the C version by David Blackman and Sebastiano Vigna (2018),
+// of the C versions by David Blackman and Sebastiano Vigna (2018),
 // https://prng.di.unimi.it/xoshiro256starstar.c
-// splitmix64 by Sebastiano Vigna (2015) 
+// https://prng.di.unimi.it/xoshiro128starstar.c
+// splitmix64 by Sebastiano Vigna (2015)
 // https://prng.di.unimi.it/splitmix64.c
+//
+// Xoshiro<Bits, Scrambler>: Bits is the state size (256 = four u64 words with 64-bit output, 128 = four
+// u32 words with 32-bit output) and the scrambler turns the linear state into output:
+//   star_star  - rotl(s1 * 5, 7) * 9, all bits good, the general-purpose choice (RNG)
+//   plus_plus  - rotl(s0 + s3, R) + s0, all bits good, no multiplies
+//   plus       - s0 + s3, the cheapest. The lowest bits are weak (low linear complexity), which
+//                doesn't matter for floats: they are built from the high bits. Vigna's pick for
+//                floating-point output.
+// 32-bit consumers can use the 128-bit variants for half the state and native 32-bit output.
+namespace xoshiro {
+    enum class scrambler { plus, plus_plus, star_star };
+}
 
-class RNG{
+template<std::size_t Bits, xoshiro::scrambler Scrambler>
+    requires (Bits == 128 || Bits == 256)
+class Xoshiro : public engine_interface<Xoshiro<Bits, Scrambler>, std::conditional_t<Bits == 256, std::uint64_t, std::uint32_t>>{
+    using base = engine_interface<Xoshiro<Bits, Scrambler>, std::conditional_t<Bits == 256, std::uint64_t, std::uint32_t>>;
 public:
-    using u64 = std::uint_fast64_t;
+    using u64 = std::uint64_t;
+    using u32 = std::uint32_t;
+    using word = typename base::result_type;
+    using base::next; //next(bound)
     static constexpr std::size_t SEED_COUNT = 4;
-    using State = std::array<u64, SEED_COUNT>;
-    using Span = std::span<const u64, SEED_COUNT>;
-    static constexpr auto USE_REJECTION_SAMPLING = false;
-    // When enabled, all ranged integer functions will use rejection sampling to ensure a more uniform 
-    // distribution of random numbers across large integer ranges. The concern with large ranges is that
-    // methods like modulo reduction (randNum % range) might not evenly distribute numbers 
-    // across the range, leading to bias. As a rule of thumb, if the range is more than half of 
-    // the maximum output (e.g., more than 2^63), you might start to see the benefits of using 
-    // rejection sampling to ensure uniformity.
-
-    constexpr explicit RNG(u64 seed) noexcept{
-        s[0] = splitmix64(seed);
-        s[1] = splitmix64(s[0] + 0x9E3779B97F4A7C15uLL);
-        s[2] = splitmix64(s[1] + 0x7F4A7C15uLL);  
-        s[3] = splitmix64(s[2] + 0x9E3779B9uLL);
-    }
-
-    constexpr explicit RNG(Span seeds) noexcept{
-        std::ranges::copy(seeds, s.begin());
+    using State = std::array<word, SEED_COUNT>;
+    using Span = std::span<const word, SEED_COUNT>;
+    // Kept for compatibility: every ranged function now draws without bias (Lemire's multiply and
+    // reject), so there is nothing left to switch.
+    static constexpr auto USE_REJECTION_SAMPLING = true;
+
+    constexpr explicit Xoshiro(u64 seed) noexcept{
+        std::array<u64, SEED_COUNT> w{};
+        w[0] = splitmix64(seed);
+        w[1] = splitmix64(w[0] + 0x9E3779B97F4A7C15uLL);
+        w[2] = splitmix64(w[1] + 0x7F4A7C15uLL);
+        w[3] = splitmix64(w[2] + 0x9E3779B9uLL);
+        for(std::size_t i = 0; i < SEED_COUNT; ++i){
+            s[i] = static_cast<word>(w[i] >> (64 - WORD_BITS)); //the high half for 128
+        }
     }
 
-    static constexpr u64 max() noexcept{
-        return std::numeric_limits<u64>::max();
+    constexpr explicit Xoshiro(Span seeds) noexcept{
+        std::ranges::copy(seeds, s.begin());
     }
 
-    constexpr u64 next() noexcept{
-        const u64 result = rotl(s[1] * 5, 7) * 9;
-        const u64 t = s[1] << 17;
+    constexpr word next() noexcept{
+        const word result = scramble();
+        const word t = s[1] << SHIFT;
         s[2] ^= s[0];
         s[3] ^= s[1];
         s[1] ^= s[2];
         s[0] ^= s[3];
         s[2] ^= t;
-        s[3] = rotl(s[3], 45);
+        s[3] = rotl(s[3], ROTATE);
         return result;
     }
 
-    constexpr bool coinToss() noexcept{
-        return next() & 1; //checks the least significant bit
+    // Bulk [0, 1) floats. The 256-bit variants take two floats from each 64-bit output (bits 40-63
+    // and 16-39; the weak low bits of the + scrambler are never used), halving the state updates.
+    // So the values are not the same as a loop of normalized<float>() calls.
+    constexpr void fill_normalized(std::span<float> out) noexcept{
+        Xoshiro copy = *this; //see engine_interface::fill
+        std::size_t i = 0;
+        if constexpr(Bits == 256){
+            for(; i + 1 < out.size(); i += 2){
+                const u64 bits = copy.next();
+                out[i] = static_cast<float>(bits >> 40) * 0x1.0p-24f;
+                out[i + 1] = static_cast<float>((bits >> 16) & 0xFFFFFFu) * 0x1.0p-24f;
+            }
+        }
+        for(; i < out.size(); ++i){
+            out[i] = portable::uniform01<float>(copy);
+        }
+        *this = copy;
     }
 
-    //returns a random number in the range [0, 1)
-    template<std::floating_point Real>
-    constexpr Real normalized() noexcept{
-        return static_cast<Real>(next()) / static_cast<Real>(max());
+    // Bulk [0, 1) doubles, the same values as a loop of normalized<double>()
+    constexpr void fill_normalized(std::span<double> out) noexcept{
+        Xoshiro copy = *this;
+        for(auto& v : out){
+            v = portable::uniform01<double>(copy);
+        }
+        *this = copy;
     }
 
+    // inRange is the original naming of this class, kept for compatibility. New code can use the
+    // shared interface (between, normalized, next(bound), ...) from engine_interface.hpp.
+
+    //[0, range)
     template<std::floating_point Real>
     constexpr Real inRange(Real range) noexcept{
-        return normalized<Real>() * range;
+        return this->template normalized<Real>() * range;
     }
 
+    //[from, to)
     template<std::floating_point Real>
     constexpr Real inRange(Real from, Real to) noexcept{
         assert(from < to && "RNG: inverted range.");
-        return from + normalized<Real>() * (to - from);
+        return this->between(from, to);
     }
 
+    //[from, to)
     template<std::integral T>
     constexpr T inRange(T from, T to) noexcept{
         assert(from < to && "RNG: inverted range.");
         using UT = std::make_unsigned_t<T>;
         UT range = static_cast<UT>(to - from);
-        return static_cast<T>(inRange(range)) + from;
+        return static_cast<T>(static_cast<UT>(from) + static_cast<UT>(inRange(static_cast<u64>(range))));
     }
 
+    //[0, range), or (range, 0] for negative ranges
     template<std::integral T>
     constexpr T inRange(T range) noexcept{
-        using UT = std::make_unsigned_t<T>;
-        UT num = static_cast<UT>(inRange(static_cast<u64>(std::abs(range))));
-        return (range < 0) ? -static_cast<T>(num) : static_cast<T>(num);
+        if constexpr(std::is_unsigned_v<T>){
+            return static_cast<T>(inRange(static_cast<u64>(range)));
+        } else {
+            using UT = std::make_unsigned_t<T>;
+            const UT magnitude = (range < 0) ? static_cast<UT>(0 - static_cast<UT>(range)) : static_cast<UT>(range);
+            UT num = static_cast<UT>(inRange(static_cast<u64>(magnitude)));
+            return (range < 0) ? -static_cast<T>(num) : static_cast<T>(num);
+        }
     }
 
+    //[0, range), Lemire's unbiased bounded draw
     constexpr u64 inRange(u64 range) noexcept{
         if(range == 0){
             assert(false && "RNG::inRange(u64) called with empty range!");
             return 0;
         }
-        if constexpr(USE_REJECTION_SAMPLING){
-            return uniformRandom(range);
-        }
-        return next() / (max() / range);
+        return portable::bounded(*this, range);
+    }
+
+    //[0, range), kept for compatibility: the same draw as inRange(u64) and next(bound)
+    constexpr u64 uniformRandom(u64 range) noexcept{
+        return inRange(range);
     }
 
     constexpr Span state() const{
         return {s};
     }
 
-    /* the jump() function is equivalent to 2^128 calls to next();
-    it can be used to generate 2^128 non-overlapping subsequences
+    constexpr bool operator==(const Xoshiro&) const noexcept = default;
+
+    /* the jump() function is equivalent to 2^128 calls to next() for the 256-bit variants, and 2^64
+    for the 128-bit ones; it can be used to generate 2^128 (2^64) non-overlapping subsequences
     for parallel computations. */
     constexpr void jump() noexcept{
-        constexpr std::array<std::bitset<64>, SEED_COUNT> JUMP{
-            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
-        };
-        State temp{0};
-        for(const auto& bits : JUMP){
-            for(std::size_t b = 0; b < 64; ++b){
-                if(bits.test(b)){
-                    temp[0] ^= s[0];
-                    temp[1] ^= s[1];
-                    temp[2] ^= s[2];
-                    temp[3] ^= s[3];
-                }
-                next();
-            }
+        if constexpr(Bits == 256){
+            apply({0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL});
+        } else {
+            apply({0x8764000bU, 0xf542d2d3U, 0x6fa035c3U, 0x77f2db5bU});
+        }
+    }
+
+    // split() (from engine_interface) seeds children through splitmix64 rather than jumping: jumps
+    // don't nest, a child that jumps to make its own children lands on its parent's next child.
+
+    /* the long_jump() function is equivalent to 2^192 calls to next() (2^96 for the 128-bit
+    variants); it can be used to generate 2^64 (2^32) starting points, from each of which jump()
+    will generate 2^64 (2^32) non-overlapping subsequences for parallel distributed computations. */
+    constexpr void long_jump() noexcept{
+        if constexpr(Bits == 256){
+            apply({0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL});
+        } else {
+            apply({0xb523952eU, 0x0b6f099fU, 0xccf5a0efU, 0x1c580662U});
         }
-        s = temp;
     }
 
     static constexpr u64 splitmix64(u64 x) noexcept{
@@ -138,26 +195,79 @@ public:
         z = (z ^ (z >> 27)) * 0x94d049bb133111ebuLL;
         return z ^ (z >> 31);
     }
-    
+
 private:
+    static constexpr int WORD_BITS = std::numeric_limits<word>::digits;
+    static constexpr int SHIFT = (Bits == 256) ? 17 : 9;
+    static constexpr int ROTATE = (Bits == 256) ? 45 : 11;
+    static constexpr int PLUS_PLUS_ROTATE = (Bits == 256) ? 23 : 7;
+
     State s{};
 
-    static constexpr u64 rotl(u64 x, int k) noexcept{
-        return (x << k) | (x >> (64 - k));
+    static constexpr word rotl(word x, int k) noexcept{
+        return static_cast<word>((x << k) | (x >> (WORD_BITS - k)));
     }
 
-    //uses rejection sampling to ensure fair scaling. Costlier than inRange(u64)
-    //if you prefer to always use rejection sampling, set USE_REJECTION_SAMPLING to true.
-    constexpr u64 uniformRandom(u64 range) noexcept{
-        if(range == 0){
-            assert(false && "RNG::uniformRandom called with empty range!");
-            return 0;
+    constexpr word scramble() const noexcept{
+        if constexpr(Scrambler == xoshiro::scrambler::star_star){
+            return static_cast<word>(rotl(static_cast<word>(s[1] * 5), 7) * 9);
+        } else if constexpr(Scrambler == xoshiro::scrambler::plus_plus){
+            return static_cast<word>(rotl(static_cast<word>(s[0] + s[3]), PLUS_PLUS_ROTATE) + s[0]);
+        } else {
+            return static_cast<word>(s[0] + s[3]);
         }
-        const u64 rangeLimit = max() - range + 1;
-        u64 n = next();
-        while((n - (n % range)) >= rangeLimit){
-            n = next();
+    }
+
+    // the state after the number of steps encoded by the jump polynomial in table
+    constexpr void apply(const State& table) noexcept{
+        State temp{};
+        for(const word bits : table){
+            for(int b = 0; b < WORD_BITS; ++b){
+                if((bits >> b) & 1u){
+                    temp[0] ^= s[0];
+                    temp[1] ^= s[1];
+                    temp[2] ^= s[2];
+                    temp[3] ^= s[3];
+                }
+                next();
+            }
         }
-        return n % range;
+        s = temp;
     }
 };
+
+using Xoshiro256ss = Xoshiro<256, xoshiro::scrambler::star_star>;
+using Xoshiro256pp = Xoshiro<256, xoshiro::scrambler::plus_plus>;
+using Xoshiro256p = Xoshiro<256, xoshiro::scrambler::plus>;
+using Xoshiro128ss = Xoshiro<128, xoshiro::scrambler::star_star>;
+using Xoshiro128pp = Xoshiro<128, xoshiro::scrambler::plus_plus>;
+using Xoshiro128p = Xoshiro<128, xoshiro::scrambler::plus>;
+using RNG = Xoshiro256ss; //the original name, kept for compatibility
+
+/* Example usage:
+#include <vector>
+#include "xoshiro256ss.h"
+
+int main() {
+    RNG rng(42);                                    //xoshiro256**, as before
+    int dice = rng.between(1, 6);
+
+    // float-heavy work: no multiplies in the scrambler, two floats per 64-bit step
+    Xoshiro256p fast(42);
+    std::vector<float> noise(4096);
+    fast.fill_normalized(noise);
+
+    // 32-bit output from 16 bytes of state
+    Xoshiro128ss small(42);
+    std::uint32_t bits = small.next();
+
+    // non-overlapping streams for worker threads
+    std::vector<Xoshiro128pp> workers;
+    Xoshiro128pp parent(7);
+    for(int i = 0; i < 8; ++i){
+        workers.push_back(parent);
+        parent.jump();                              //2^64 steps ahead
+    }
+    return dice + static_cast<int>(bits & 1) + static_cast<int>(noise[0] > 0.5f);
+}
+*/
@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "portable_math.hpp"
+// Marsaglia & Tsang's ziggurat method, "The Ziggurat Method for Generating Random Variables" (2000).
+//
+// The density is covered by 256 horizontal layers of equal area. A single 64-bit draw picks the
+// layer (low 8 bits) and the position within it (high 53 bits), and ~99% of the time the point lands
+// inside the density and is returned after one multiply and one compare. Only the rare wedge and tail
+// cases pay for an exp() or log().
+//
+// Unlike the original paper the layer index and the position use disjoint bits, avoiding the known
+// correlation between the two. The tables are built at compile time with the portable math in
+// portable_math.hpp, so the samples are bit-identical across compilers and usable in constexpr code.
+PORTABLE_FP_BEGIN
+namespace portable::ziggurat {
+    inline constexpr std::size_t LAYERS = 256;
+
+    struct table {
+        double r;                                //where the tail starts
+        std::array<double, LAYERS + 1> x;        //layer edges, x[0] is the virtual width of the base layer
+        std::array<double, LAYERS + 1> f;        //density at each edge
+        std::array<double, LAYERS> w;            //x[i] / 2^53, scales a 53-bit integer into layer i
+        std::array<u64, LAYERS> k;               //x[i+1] / x[i] * 2^53, the fast acceptance threshold
+    };
+
+    // Builds the tables for a decreasing density f on [0, inf) with inverse f_inv, tail start r and
+    // layer area v.
+    template<typename F, typename FInv>
+    constexpr table make_table(double r, double v, F f, FInv f_inv) noexcept {
+        table t{};
+        t.r = r;
+        t.x[0] = v / f(r);
+        t.x[1] = r;
+        for(std::size_t i = 1; i < LAYERS - 1; ++i){
+            const double y = f(t.x[i]) + v / t.x[i];
+            t.x[i + 1] = (y < 1.0) ? f_inv(y) : 0.0;
+        }
+        t.x[LAYERS] = 0.0;
+        for(std::size_t i = 0; i <= LAYERS; ++i){
+            t.f[i] = f(t.x[i]);
+        }
+        for(std::size_t i = 0; i < LAYERS; ++i){
+            t.w[i] = t.x[i] * 0x1.0p-53;
+            t.k[i] = static_cast<u64>(t.x[i + 1] / t.x[i] * 0x1.0p53);
+        }
+        return t;
+    }
+
+    // exp(-x), r and v from Marsaglia & Tsang for 256 layers
+    inline constexpr table exponential_table = make_table(7.69711747013104972, 0.0039496598225815571993,
+        [](double x){ return portable::exp(-x); },
+        [](double y){ return -portable::log(y); });
+
+    // Exp(1)
+    template<full_range_engine G>
+    constexpr double exponential(G& g) noexcept(noexcept(g())) {
+        constexpr const table& t = exponential_table;
+        while(true){
+            const u64 bits = bits64(g);
+            const auto i = static_cast<std::size_t>(bits & 0xFF);
+            const u64 u = bits >> 11;
+            const double x = static_cast<double>(u) * t.w[i];
+            if(u < t.k[i]){
+                return x;
+            }
+            if(i == 0){ //the exponential is memoryless, so the tail is just r + Exp(1)
+                return t.r - portable::log(uniform01_open(g));
+            }
+            if(t.f[i] + uniform01(g) * (t.f[i + 1] - t.f[i]) < portable::exp(-x)){
+                return x;
+            }
+        }
+    }
+
+    // exp(-x^2/2), r and v from Marsaglia & Tsang for 256 layers
+    inline constexpr table normal_table = make_table(3.6541528853610088, 0.00492867323399,
+        [](double x){ return portable::exp(-0.5 * x * x); },
+        [](double y){ return portable::sqrt(-2.0 * portable::log(y)); });
+
+    // N(0, 1). Bit 8 of the draw picks the sign.
+    template<full_range_engine G>
+    constexpr double normal(G& g) noexcept(noexcept(g())) {
+        constexpr const table& t = normal_table;
+        while(true){
+            const u64 bits = bits64(g);
+            const auto i = static_cast<std::size_t>(bits & 0xFF);
+            const bool negative = bits & 0x100;
+            const u64 u = bits >> 11;
+            double x = static_cast<double>(u) * t.w[i];
+            if(u < t.k[i]){
+                return negative ? -x : x;
+            }
+            if(i == 0){ //tail, Marsaglia (1964)
+                double y;
+                do{
+                    x = -portable::log(uniform01_open(g)) / t.r;
+                    y = -portable::log(uniform01_open(g));
+                } while(y + y < x * x);
+                x += t.r;
+                return negative ? -x : x;
+            }
+            if(t.f[i] + uniform01(g) * (t.f[i + 1] - t.f[i]) < portable::exp(-0.5 * x * x)){
+                return negative ? -x : x;
+            }
+        }
+    }
+}
+PORTABLE_FP_END